@@ -6,6 +6,10 @@ void *kernel_memcpy_armv6v7(void *dest, const void *src, size_t size);
 void *kernel_copy_from_user_armv6v7(void *dest, const void *src, size_t size);
 void *kernel_copy_to_user_armv6v7(void *dest, const void *src, size_t size);
 
+uint32_t kernel_csum_partial_copy_armv6v7(void *dest, const void *src, size_t size,
+    uint32_t sum);
+uint32_t kernel_csum_partial_armv6v7(const void *buf, size_t size, uint32_t sum);
+
 void *kernel_memset_orig(void *dest, int c, size_t size);
 void *kernel_memset(void *dest, int c, size_t size);
 
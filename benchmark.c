@@ -22,6 +22,7 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -30,29 +31,260 @@
 #include <ctype.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <sys/auxv.h>
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <linux/mempolicy.h>
+#ifndef HOST
+#include <ucontext.h>
+#endif
 
 #include "asm.h"
 #include "new_arm.h"
+#include "new_arm_tune.h"
+#include "trace.h"
+#ifdef HOST
+#include "host_defines.h"
+#else
+#include "kernel_defines.h"
+#endif
 
 #define DEFAULT_TEST_DURATION 2.0
 #define RANDOM_BUFFER_SIZE 256
 
-#define NU_MEMCPY_VARIANTS 7
-#define NU_MEMSET_VARIANTS 8
+#define BUFFER_SIZE (1024 * 1024 * 32)
+#define MAX_THREADS 256
+/* Number of calls timed together in latency mode. */
+#define LATENCY_BATCH_SIZE 8
+/* Number of hardware event counters in counters mode. */
+#define NU_COUNTERS 7
+/* The number of empty calls counted for the harness baseline. */
+#define COUNTER_BASELINE_CALLS (1024 * 1024 * 4)
+#define MAX_NUMA_NODES 64
+/* The block size of the copies in the NUMA placement mode. */
+#define NUMA_BLOCK_SIZE (1024 * 1024 * 4)
+
+/* Variants are selected with the letters a-z and A-Z. */
+#define MAX_VARIANTS 52
+#define MAX_SAMPLES 1000
+#define BOOTSTRAP_RESAMPLES 2000
+#define DEFAULT_TIME_BUDGET 60.0
+
+/* The default workload mix and test duration for --tune. */
+#define DEFAULT_TUNE_MIX "0,1,2,24,28,36,46"
+#define DEFAULT_TUNE_DURATION 0.1
+/* The number of best variants that are measured again with repeats. */
+#define TUNE_FINALISTS 5
+/*
+ * The working set sizes of the cache-size sweep, with up to
+ * SWEEP_MAX_STEPS steps per doubling, and its default test duration.
+ */
+#define SWEEP_MIN_BYTES 64
+#define SWEEP_MAX_BYTES (64 * 1024 * 1024)
+#define SWEEP_MAX_STEPS 8
+#define SWEEP_MAX_POINTS (20 * SWEEP_MAX_STEPS + 1)
+#define DEFAULT_SWEEP_STEPS 2
+#define DEFAULT_SWEEP_DURATION 0.1
+/*
+ * A cache boundary is where the bandwidth falls below SWEEP_CLIFF times
+ * the best bandwidth since the previous boundary. Further points that are
+ * below SWEEP_FALLING times the previous one belong to the same cliff.
+ */
+#define SWEEP_CLIFF 0.8
+#define SWEEP_FALLING 0.95
+/*
+ * Workloads defined with --workload and --workload-file. The source region
+ * starts at the start of the buffer and the destination region at
+ * WORKLOAD_DEST_OFFSET, each at most WORKLOAD_MAX_REGION bytes.
+ */
+#define MAX_WORKLOADS 64
+#define WORKLOAD_DEST_OFFSET (16 * 1024 * 1024)
+#define WORKLOAD_MAX_REGION (16 * 1024 * 1024 - 4096)
+#define WORKLOAD_MAX_COUNT 65536
+#define DEFAULT_WORKLOAD_REGION (64 * 1024)
+#define DEFAULT_WORKLOAD_COUNT 1024
+
+#define NU_MEMCPY_VARIANTS 21
+#define NU_MEMSET_VARIANTS 10
+#define NU_MEMMOVE_VARIANTS 3
+#define NU_CSUM_VARIANTS 3
+#define NU_CRC_VARIANTS 4
+#define NU_FAULT_VARIANTS 2
+#define NU_REMAP_VARIANTS 3
+#define NU_VEC_VARIANTS 4
+/* The number of descriptors in a batch in the vec tests. */
+#define VEC_BATCH_SIZE 32
+/* The size from which the remap front end moves pages instead of copying. */
+#define DEFAULT_REMAP_THRESHOLD (64 * 1024)
+
+/*
+ * The user buffers in fault mode end at one of FAULT_NU_GUARD_PAGES
+ * inaccessible pages, which are FAULT_GUARD_STRIDE bytes apart.
+ */
+#define FAULT_NU_GUARD_PAGES 16
+#define FAULT_GUARD_STRIDE (128 * 1024)
 
 typedef void *(*memcpy_func_type)(void *dest, const void *src, size_t n);
 typedef void *(*memset_func_type)(void *dest, int c, size_t n);
+typedef uint32_t (*csum_copy_func_type)(void *dest, const void *src, size_t n,
+    uint32_t sum);
+typedef uint32_t (*crc_copy_func_type)(void *dest, const void *src, size_t n,
+    uint32_t crc);
+typedef void (*vec_func_type)(const struct copy_desc *descs, size_t n);
 
 memcpy_func_type memcpy_func;
 memset_func_type memset_func;
-uint8_t *buffer_alloc, *buffer_chunk, *buffer_page, *buffer_compare;
+memcpy_func_type memmove_func;
+csum_copy_func_type csum_copy_func;
+crc_copy_func_type crc_copy_func;
+vec_func_type vec_func;
+uint8_t *buffer_alloc, *buffer_compare;
+/*
+ * The buffers used by the tests are thread-local so that each thread in
+ * multi-threaded mode works on its own slice of buffer_alloc.
+ */
+__thread uint8_t *buffer_chunk, *buffer_page;
 int *random_buffer_1024, *random_buffer_1M, *random_buffer_powers_of_two_up_to_4096_power_law;
 int *random_buffer_multiples_of_four_up_to_1024_power_law, *random_buffer_up_to_1023_power_law;
 double test_duration = DEFAULT_TEST_DURATION;
 int memcpy_mask[NU_MEMCPY_VARIANTS];
 int memset_mask[NU_MEMSET_VARIANTS];
+int memmove_mask[NU_MEMMOVE_VARIANTS];
+int csum_mask[NU_CSUM_VARIANTS];
+int crc_mask[NU_CRC_VARIANTS];
+int fault_mask[NU_FAULT_VARIANTS];
+uint8_t *fault_region;
+/* Set when the fault mode variant copies to the user buffer. */
+int fault_to_user;
+int remap_mask[NU_REMAP_VARIANTS];
+size_t remap_threshold = DEFAULT_REMAP_THRESHOLD;
+/* Set when the kernel supports MREMAP_DONTUNMAP. */
+int remap_dontunmap;
+int vec_mask[NU_VEC_VARIANTS];
+/* The descriptors replayed by the vec tests, RANDOM_BUFFER_SIZE of each. */
+struct copy_desc *vec_descs_in_cache, *vec_descs_scattered, *vec_descs_unaligned;
 int test_alignment;
+int nu_threads = 1;
+int latency_mode = 0;
+/* Size in KB of the cache-resident victim buffer in victim mode. */
+int victim_kb = 0;
+uint8_t *victim_buffer;
+volatile uint32_t victim_sink;
+/* Count hardware events with perf_event_open() (--counters). */
+int counters_mode = 0;
+/*
+ * Precomputed operation streams (--precompute). The calls of a memcpy or
+ * memset test are recorded once into a structure of arrays, and the timed
+ * loop replays them with the cost of an empty replay subtracted.
+ */
+#define STREAM_LENGTH RANDOM_BUFFER_SIZE
+#define STREAM_CALIBRATION_PASSES 1000
+#define STREAM_CALIBRATION_RUNS 5
+/* A pass over the streams is cut short after this many bytes. */
+#define STREAM_MAX_BYTES (64 * 1024 * 1024)
+int stream_mode = 0;
+void *stream_dest[STREAM_LENGTH];
+const void *stream_src[STREAM_LENGTH];
+uint32_t stream_size[STREAM_LENGTH];
+uint8_t stream_value[STREAM_LENGTH];
+int stream_nu_ops;
+int stream_is_memset;
+long long stream_bytes;
+/* The time of the empty replay per call, in ns. */
+double stream_baseline_ns;
+/*
+ * Cache state of the measurement (--cache). Warm skips the cache clearing
+ * before the warm-up. Cold and l2 also measure with the caches (the data
+ * caches up to the last level, or only the L1 data cache) evicted before
+ * every batch of cache_batch calls, by walking an eviction buffer twice
+ * the size of the cache and running an instruction cache sized block of
+ * code. The eviction buffer uses 4K pages, so the walk also evicts the
+ * TLB entries.
+ */
+enum { CACHE_DEFAULT, CACHE_WARM, CACHE_COLD, CACHE_L2 };
+static const char *cache_mode_name[] = { "default", "warm", "cold", "l2" };
+#define DEFAULT_LLC_SIZE (32 * 1024 * 1024)
+#define DEFAULT_L1_SIZE (64 * 1024)
+#define MIN_COLD_BATCHES 16
+int cache_mode = CACHE_DEFAULT;
+int cache_batch = 1;
+uint8_t *evict_buffer;
+size_t evict_size;
+void *evict_code;
+volatile uint32_t evict_sink;
+/* The time of taking two timestamps, subtracted from every timed batch. */
+uint64_t timer_overhead_ns;
+
+enum { FORMAT_TEXT, FORMAT_JSON, FORMAT_CSV };
+int output_format = FORMAT_TEXT;
+/*
+ * NUMA placement mode (--numa-matrix, --src-node and --dst-node), with the
+ * source and destination buffers of the current test.
+ */
+int numa_mode = 0;
+uint8_t *numa_source, *numa_dest;
+/* The pages backing the test buffers (--pages). */
+enum { PAGES_DEFAULT, PAGES_4K, PAGES_THP, PAGES_HUGETLB };
+int page_mode = PAGES_DEFAULT;
+static const char *page_mode_name[] = { "default", "4k", "thp", "hugetlb" };
+/*
+ * Cache-size sweep mode (--sweep). The source and destination offsets
+ * from a page boundary and the stride are set with --src-align,
+ * --dst-align and --stride; the copy of the current point walks the
+ * region of sweep_region bytes in calls of sweep_block bytes.
+ */
+int sweep_mode = 0;
+int sweep_steps = DEFAULT_SWEEP_STEPS;
+int sweep_src_align = 0, sweep_dst_align = 0;
+int sweep_stride = 0;
+uint8_t *sweep_source, *sweep_dest;
+int sweep_region, sweep_block, sweep_offset;
+int nu_results_output = 0;
+int stats_mode = 0;
+int compare_mode = 0;
+/* Target relative width of the 95% confidence interval in adaptive mode. */
+double target_ci_width = 0;
+double time_budget = DEFAULT_TIME_BUDGET;
+/* The memcpy or memset variant currently being tested. */
+int current_variant;
+/* Trace replay (--trace). */
+const char *trace_file = NULL;
+trace_record_t *trace_memcpy_records, *trace_memset_records;
+int trace_nu_memcpy_records, trace_nu_memset_records;
+int trace_memcpy_bytes, trace_memset_bytes;
+__thread int trace_position;
+/*
+ * A workload spec. The sizes are drawn from a distribution between
+ * size_min and size_max and rounded down to a multiple of size_multiple,
+ * and the source and destination offsets are multiples of their alignment
+ * class plus a fixed offset, placed by the address pattern.
+ */
+enum { SIZE_FIXED, SIZE_UNIFORM, SIZE_POW2, SIZE_POWER_LAW };
+enum { PATTERN_RANDOM, PATTERN_SEQUENTIAL, PATTERN_FIXED };
+typedef struct {
+    const char *spec;
+    int size_distribution;
+    int size_min, size_max, size_multiple;
+    int src_align, src_offset, dst_align, dst_offset;
+    int region;
+    int pattern;
+    int count;
+    unsigned int seed;
+} workload_t;
+workload_t workload[MAX_WORKLOADS];
+int nu_workloads = 0;
+/* The generated calls of the current workload. */
+struct copy_desc *workload_descs, *workload_descs_end;
+const char *current_variant_name;
 
 static void *copy_page_wrapper(void *dest, const void *src, size_t n) {
 	kernel_copy_page(dest, src);
@@ -64,6 +296,12 @@ static void *copy_page_orig_wrapper(void *dest, const void *src, size_t n) {
 	return dest;
 }
 
+/*
+ * The CPU feature each variant requires beyond the base architecture, in
+ * the *_variant_feature tables. See deselect_unsupported_variants().
+ */
+enum { FEATURE_NONE, FEATURE_NEON, FEATURE_CRC32 };
+
 static const char *memcpy_variant_name[NU_MEMCPY_VARIANTS] = {
     "libc memcpy",
     "kernel memcpy (original)",
@@ -72,6 +310,20 @@ static const char *memcpy_variant_name[NU_MEMCPY_VARIANTS] = {
     "kernel copy_to_user (optimized)",
     "kernel copy_page (original)",
     "kernel copy_page (optimized)",
+    "new memcpy (line size 64, preload 192)",
+    "new memcpy (line size 64, preload 192, align 32)",
+    "new memcpy (line size 64, preload 192, aligned access)",
+    "new memcpy (line size 32, preload 192)",
+    "new memcpy (line size 32, preload 192, align 32)",
+    "new memcpy (line size 32, preload 96)",
+    "new memcpy (line size 32, preload 96, aligned access)",
+    "new memcpy (size class dispatch, line size 64, preload 192)",
+    "new memcpy (size class dispatch, line size 32, preload 96)",
+    "new memcpy NEON (large copy mode, line size 64, preload 192)",
+    "new memcpy NEON (large copy mode, line size 32, preload 96)",
+    "new memcpy NEON (line size 64, preload 192)",
+    "new memcpy NEON (line size 64, preload 192, align 32)",
+    "new memcpy NEON (line size 32, preload 192, align 32)",
 };
 
 static const memcpy_func_type memcpy_variant[NU_MEMCPY_VARIANTS] = {
@@ -81,7 +333,29 @@ static const memcpy_func_type memcpy_variant[NU_MEMCPY_VARIANTS] = {
     kernel_copy_from_user_armv6v7,
     kernel_copy_to_user_armv6v7,
     copy_page_orig_wrapper,
-    copy_page_wrapper
+    copy_page_wrapper,
+    memcpy_new_line_size_64_preload_192,
+    memcpy_new_line_size_64_preload_192_align_32,
+    memcpy_new_line_size_64_preload_192_aligned_access,
+    memcpy_new_line_size_32_preload_192,
+    memcpy_new_line_size_32_preload_192_align_32,
+    memcpy_new_line_size_32_preload_96,
+    memcpy_new_line_size_32_preload_96_aligned_access,
+    memcpy_new_size_class_line_size_64_preload_192,
+    memcpy_new_size_class_line_size_32_preload_96,
+    memcpy_new_large_line_size_64_preload_192,
+    memcpy_new_large_line_size_32_preload_96,
+    memcpy_new_neon_line_size_64_preload_192,
+    memcpy_new_neon_line_size_64_preload_192_align_32,
+    memcpy_new_neon_line_size_32_preload_192_align_32
+};
+
+static const int memcpy_variant_feature[NU_MEMCPY_VARIANTS] = {
+    FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NONE,
+    FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NONE,
+    FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NONE,
+    FEATURE_NONE, FEATURE_NEON, FEATURE_NEON, FEATURE_NEON, FEATURE_NEON,
+    FEATURE_NEON
 };
 
 static void *memzero_orig_wrapper(void *dest, int c, size_t n) {
@@ -103,6 +377,8 @@ static const char *memset_variant_name[NU_MEMSET_VARIANTS] = {
     "new libc memset (align = 0)",
     "new libc memset (align = 8)",
     "new libc memset (align = 32)",
+    "new libc memset NEON (align = 0)",
+    "new libc memset NEON (align = 32)",
 };
 
 static const memset_func_type memset_variant[NU_MEMSET_VARIANTS] = {
@@ -113,7 +389,192 @@ static const memset_func_type memset_variant[NU_MEMSET_VARIANTS] = {
     memzero_wrapper,
     memset_new_align_0,
     memset_new_align_8,
-    memset_new_align_32
+    memset_new_align_32,
+    memset_new_neon_align_0,
+    memset_new_neon_align_32
+};
+
+static const int memset_variant_feature[NU_MEMSET_VARIANTS] = {
+    FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NONE,
+    FEATURE_NONE, FEATURE_NONE, FEATURE_NONE, FEATURE_NEON, FEATURE_NEON
+};
+
+static const char *memmove_variant_name[NU_MEMMOVE_VARIANTS] = {
+    "libc memmove",
+    "new memmove (line size 64, preload 192)",
+    "new memmove (line size 32, preload 96)",
+};
+
+static const memcpy_func_type memmove_variant[NU_MEMMOVE_VARIANTS] = {
+    memmove,
+    memmove_new_line_size_64_preload_192,
+    memmove_new_line_size_32_preload_96
+};
+
+/*
+ * The baselines for the fused copy and checksum copy the data first and
+ * then checksum the destination in a second pass.
+ */
+static uint32_t memcpy_csum_wrapper(void *dest, const void *src, size_t n,
+uint32_t sum) {
+    memcpy(dest, src, n);
+    return kernel_csum_partial_armv6v7(dest, n, sum);
+}
+
+static uint32_t kernel_memcpy_csum_wrapper(void *dest, const void *src,
+size_t n, uint32_t sum) {
+    kernel_memcpy_armv6v7(dest, src, n);
+    return kernel_csum_partial_armv6v7(dest, n, sum);
+}
+
+static const char *csum_variant_name[NU_CSUM_VARIANTS] = {
+    "libc memcpy, then kernel csum_partial",
+    "kernel memcpy (optimized), then kernel csum_partial",
+    "kernel csum_partial_copy (fused)",
+};
+
+static const csum_copy_func_type csum_variant[NU_CSUM_VARIANTS] = {
+    memcpy_csum_wrapper,
+    kernel_memcpy_csum_wrapper,
+    kernel_csum_partial_copy_armv6v7
+};
+
+/*
+ * The baselines for the fused copy and CRC32C copy the data first and then
+ * compute the CRC of the destination in a second pass.
+ */
+static uint32_t memcpy_crc32c_wrapper(void *dest, const void *src, size_t n,
+uint32_t crc) {
+    memcpy(dest, src, n);
+    return crc32c_new_line_size_64_preload_192(dest, n, crc);
+}
+
+static uint32_t memcpy_crc32c_crc32_wrapper(void *dest, const void *src,
+size_t n, uint32_t crc) {
+    memcpy(dest, src, n);
+    return crc32c_new_crc32_line_size_64_preload_192(dest, n, crc);
+}
+
+static const char *crc_variant_name[NU_CRC_VARIANTS] = {
+    "libc memcpy, then new crc32c (slice-by-8)",
+    "libc memcpy, then new crc32c (CRC32 instructions)",
+    "new memcpy_crc32c (fused, slice-by-8, line size 64, preload 192)",
+    "new memcpy_crc32c (fused, CRC32 instructions, line size 64, preload 192)",
+};
+
+static const crc_copy_func_type crc_variant[NU_CRC_VARIANTS] = {
+    memcpy_crc32c_wrapper,
+    memcpy_crc32c_crc32_wrapper,
+    memcpy_crc32c_new_line_size_64_preload_192,
+    memcpy_crc32c_new_crc32_line_size_64_preload_192
+};
+
+static const int crc_variant_feature[NU_CRC_VARIANTS] = {
+    FEATURE_NONE, FEATURE_CRC32, FEATURE_NONE, FEATURE_CRC32
+};
+
+static const char *fault_variant_name[NU_FAULT_VARIANTS] = {
+    "kernel copy_from_user (optimized)",
+    "kernel copy_to_user (optimized)",
+};
+
+static const memcpy_func_type fault_variant[NU_FAULT_VARIANTS] = {
+    kernel_copy_from_user_armv6v7,
+    kernel_copy_to_user_armv6v7
+};
+
+static const int fault_variant_to_user[NU_FAULT_VARIANTS] = { 0, 1 };
+
+/*
+ * Move front end for large page-aligned copies. When the destination, the
+ * source and the size are page aligned and the size is at least
+ * remap_threshold, the pages of the source are moved to the destination
+ * with mremap() instead of being copied. The source stays mapped but reads
+ * as zeroes afterwards, so this is only a replacement for memcpy when the
+ * source isn't used again (a move), and the source must be private
+ * anonymous memory. Anything else is copied with the optimized memcpy.
+ */
+static void *memcpy_remap(void *dest, const void *src, size_t n) {
+    if (n >= remap_threshold &&
+    (((uintptr_t)dest | (uintptr_t)src | n) & (PAGE_SZ - 1)) == 0) {
+        if (remap_dontunmap) {
+            if (mremap((void *)src, n, n, MREMAP_MAYMOVE | MREMAP_FIXED |
+            MREMAP_DONTUNMAP, dest) != MAP_FAILED)
+                return dest;
+        }
+        else if (mremap((void *)src, n, n, MREMAP_MAYMOVE | MREMAP_FIXED,
+        dest) != MAP_FAILED) {
+            /*
+             * Map zero pages at the source, like MREMAP_DONTUNMAP does. If
+             * that fails the source is left unmapped, and the next access
+             * would crash, so give up.
+             */
+            if (mmap((void *)src, n, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, - 1, 0) == MAP_FAILED) {
+                printf("Unable to map the source again after mremap().\n");
+                exit(1);
+            }
+            return dest;
+        }
+    }
+    return kernel_memcpy_armv6v7(dest, src, n);
+}
+
+/* Check whether the kernel supports MREMAP_DONTUNMAP (Linux 5.7). */
+static void init_remap() {
+    uint8_t *p = mmap(NULL, 2 * PAGE_SZ, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, - 1, 0);
+    if (p == MAP_FAILED)
+        return;
+    p[0] = 1;
+    remap_dontunmap = mremap(p, PAGE_SZ, PAGE_SZ, MREMAP_MAYMOVE |
+        MREMAP_FIXED | MREMAP_DONTUNMAP, p + PAGE_SZ) != MAP_FAILED;
+    munmap(p, 2 * PAGE_SZ);
+}
+
+/* Copy whole pages with copy_page, the baseline for the remap mode. */
+static void *copy_pages_wrapper(void *dest, const void *src, size_t n) {
+    for (size_t i = 0; i < n; i += 4096)
+        kernel_copy_page((uint8_t *)dest + i, (const uint8_t *)src + i);
+    return dest;
+}
+
+static const char *remap_variant_name[NU_REMAP_VARIANTS] = {
+    "kernel copy_page (page by page)",
+    "kernel memcpy (optimized)",
+    "remap front end (mremap at or above the threshold, else kernel memcpy (optimized))",
+};
+
+static const memcpy_func_type remap_variant[NU_REMAP_VARIANTS] = {
+    copy_pages_wrapper,
+    kernel_memcpy_armv6v7,
+    memcpy_remap
+};
+
+/* Copy a batch with one memcpy call per descriptor, the baselines for vec. */
+static void memcpy_vec_libc(const struct copy_desc *descs, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        memcpy(descs[i].dest, descs[i].src, descs[i].n);
+}
+
+static void memcpy_vec_new_calls(const struct copy_desc *descs, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        memcpy_new_line_size_64_preload_192(descs[i].dest, descs[i].src,
+            descs[i].n);
+}
+
+static const char *vec_variant_name[NU_VEC_VARIANTS] = {
+    "libc memcpy (one call per descriptor)",
+    "new memcpy (line size 64, preload 192, one call per descriptor)",
+    "new memcpy_vec (line size 64, preload 192)",
+    "new memcpy_vec (line size 32, preload 96)",
+};
+
+static const vec_func_type vec_variant[NU_VEC_VARIANTS] = {
+    memcpy_vec_libc,
+    memcpy_vec_new_calls,
+    memcpy_vec_new_line_size_64_preload_192,
+    memcpy_vec_new_line_size_32_preload_96
 };
 
 static double get_time() {
@@ -122,6 +583,17 @@ static double get_time() {
    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
 }
 
+#ifndef CLOCK_MONOTONIC_RAW
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+/* High resolution clock for latency measurement, in nanoseconds. */
+static inline uint64_t get_time_ns() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 static void test_mixed_powers_of_two_word_aligned(int i) {
     memcpy_func(buffer_page + random_buffer_1M[(i * 2) & (RANDOM_BUFFER_SIZE - 1)] * 4,
         buffer_page + random_buffer_1M[(i * 2 + 1) & (RANDOM_BUFFER_SIZE - 1)] * 4,
@@ -606,194 +1078,2804 @@ static void test_memset_unaligned_random_1023(int i) {
         1023);
 }
 
-static void clear_data_cache() {
-    int val = 0;
-    for (int i = 0; i < 1024 * 1024 * 32; i += 4) {
-        val += buffer_alloc[i];
-    }
-    for (int i = 0; i < 1024 * 1024 * 32; i += 4) {
-        buffer_alloc[i] = val;
-    }
+/*
+ * memmove tests. The destination is the source moved up (a backward copy)
+ * or down (a forward copy) by the given distance, so that the buffers
+ * overlap when the distance is smaller than the size.
+ */
+static inline void memmove_moved(int i, int size, int align_shift,
+int distance) {
+    uint8_t *src = buffer_page + 65536 +
+        (random_buffer_1024[i & (RANDOM_BUFFER_SIZE - 1)] << align_shift);
+    memmove_func(src + distance, src, size);
 }
 
-static void do_test(const char *name, void (*test_func)(int), int bytes) {
-    int nu_iterations;
-    if (bytes >= 1024) 
-        nu_iterations = (64 * 1024 * 1024) / bytes;
-    else if (bytes >= 64)
-        nu_iterations = (16 * 1024 * 1024) / bytes;
-    else
-        nu_iterations = 1024 * 1024 / 2;
-    /* Warm-up. */
-    clear_data_cache();
-    double temp_time = get_time();
-    for (int i = 0; i < nu_iterations; i++)
-       test_func(i);
-    usleep(100000);
-    double start_time = get_time();
-    double end_time;
-    int count = 0;
-    for (;;) {
-        for (int i = 0; i < nu_iterations; i++)
-            test_func(i);
-        count++;
-        end_time = get_time();
-        if (end_time - start_time >= test_duration)
-            break;
-    }
-    double bandwidth = (double)bytes * nu_iterations * count / (1024 * 1024)
-        / (end_time - start_time);
-    printf("%s: %.2lf MB/s\n", name, bandwidth);
+/* A random distance from 1 to 32 bytes. */
+static inline int memmove_distance(int i) {
+    return 1 + (random_buffer_1024[(i + 1) & (RANDOM_BUFFER_SIZE - 1)] & 31);
 }
 
-static void do_test_all(const char *name, void (*test_func)(), int bytes) {
-    for (int j = 0; j < NU_MEMCPY_VARIANTS; j++)
-        if (memcpy_mask[j]) {
-            printf("%s:\n", memcpy_variant_name[j]);
-            memcpy_func = memcpy_variant[j];
-            do_test(name, test_func, bytes);
-        }
+static void test_memmove_mixed_power_law_unaligned(int i) {
+    uint8_t *src = buffer_page + 65536 +
+        random_buffer_1M[(i * 2) & (RANDOM_BUFFER_SIZE - 1)];
+    memmove_func(src - 64 +
+        (random_buffer_1024[(i * 2 + 1) & (RANDOM_BUFFER_SIZE - 1)] & 127), src,
+        random_buffer_up_to_1023_power_law[i & (RANDOM_BUFFER_SIZE - 1)]);
 }
 
-static void fill_buffer(uint8_t *buffer) {
-    for (int i = 0; i < 1024 * 1024 * 16; i++) {
-        buffer[i] = i & 0xFF;
-    }
+static void test_memmove_aligned_64_up(int i) {
+    memmove_moved(i, 64, 2, 4);
 }
 
-static int compare_buffers(uint8_t *buffer0, uint8_t *buffer1) {
-    int identical = 1;
-    int count = 0;
-    for (int i = 0; i < 1024 * 1024 * 16; i++) {
-        if (buffer0[i] != buffer1[i]) {
-            count++;
-	    if (count < 10) {
-                printf("Byte at offset %d (0x%08X) doesn't match.\n",
-                    i, i);
-                identical = 0;
-            }
-	}
-    }
-    if (count >= 10) {
-        printf("(%d more non-matching bytes present.)\n", count - 9);
-    }
-    return identical;
+static void test_memmove_aligned_64_down(int i) {
+    memmove_moved(i, 64, 2, - 4);
 }
 
-static void memcpy_emulate(uint8_t *dest, uint8_t *src, int size) {
-    for (int i = 0; i < size; i++)
-        dest[i] = src[i];
+static void test_memmove_unaligned_random_64_up(int i) {
+    memmove_moved(i, 64, 0, memmove_distance(i));
 }
 
-static void do_validation(int repeat) {
-    int passed = 1;
-    for (int i = 0; i < 10 * repeat; i++)  {
-        int size, source, dest;
-        if (memcpy_func == copy_page_wrapper ||
-        memcpy_func == copy_page_orig_wrapper) {
-            size = 4096;
-            source = 4096 * (rand() % (1024 * 1024 * 16 / 4096));
-            do {
-                dest = 4096 * (rand() % (1024 * 1024 * 16 / 4096));
-            } while (dest == source);
-        }
-        else {
-            size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
-            source = rand() % (1024 * 1024 * 16 + 1 - size);
-            int aligned = 0;
-            if ((rand() & 3) == 0) {
-		aligned = 1;
-                source &= ~3;
-                size = (size + 3) & (~3);
-            }
-            do {
-                dest = rand() % (1024 * 1024 * 16 + 1 - size);
-                if (aligned)
-                    dest &= ~3;
-            }
-            while (dest + size > source && dest < source + size);
-        }
-        printf("Testing (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
-                source, dest, size);
-        fflush(stdout);
-        fill_buffer(buffer_compare);
-        memcpy_emulate(buffer_compare + dest, buffer_compare + source, size);
-        fill_buffer(buffer_alloc);
-        memcpy_func(buffer_alloc + dest, buffer_alloc + source, size);
-        if (!compare_buffers(buffer_alloc, buffer_compare)) {
-            printf("Validation failed (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
-                source, dest, size);
-            passed = 0;
-        }
-    }
-    if (passed) {
-        printf("Passed.\n");
-    }
+static void test_memmove_unaligned_random_64_down(int i) {
+    memmove_moved(i, 64, 0, - memmove_distance(i));
 }
 
-static void memset_emulate(uint8_t *dest, int c, int size) {
-    for (int i = 0; i < size; i++)
-        dest[i] = c;
+static void test_memmove_aligned_1024_up(int i) {
+    memmove_moved(i, 1024, 2, 4);
 }
 
-static void do_validation_memset(int repeat) {
-    int passed = 1;
-    for (int i = 0; i < 10 * repeat; i++)  {
-        int size, dest, c;
-        size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
-        dest = rand() % (1024 * 1024 * 16 + 1 - size);
-        if (memset_func == memzero_orig_wrapper || memset_func == memzero_wrapper)
-            c = 0;
-        else
-            c = rand() & 0xFF;
-        printf("Testing (destination offset = 0x%08X, byte = %d, size = %d).\n",
-                dest, c, size);
-        fflush(stdout);
-        fill_buffer(buffer_compare);
-        memset_emulate(buffer_compare + dest, c, size);
-        fill_buffer(buffer_alloc);
-        memset_func(buffer_alloc + dest, c, size);
-        if (!compare_buffers(buffer_alloc, buffer_compare)) {
-            printf("Validation failed (destination offset = 0x%08X, size = %d).\n",
-                dest, size);
-            passed = 0;
-        }
-    }
-    if (passed) {
-        printf("Passed.\n");
-    }
+static void test_memmove_aligned_1024_down(int i) {
+    memmove_moved(i, 1024, 2, - 4);
 }
 
-#define NU_TESTS 50
+static void test_memmove_unaligned_random_1024_up(int i) {
+    memmove_moved(i, 1024, 0, memmove_distance(i));
+}
 
-typedef struct {
-    const char *name;
-    void (*test_func)();
-    int bytes;
-} test_t;
+static void test_memmove_unaligned_random_1024_down(int i) {
+    memmove_moved(i, 1024, 0, - memmove_distance(i));
+}
 
-static test_t test[NU_TESTS] = {
-    { "Mixed powers of 2 from 4 to 4096 (power law), word aligned", test_mixed_powers_of_two_word_aligned, 32768 },
-    { "Mixed multiples of 4 from 4 to 1024 (power law), word aligned", test_mixed_power_law_word_aligned, 32768 },
-    { "Mixed from 1 to 1023 (power law), unaligned", test_mixed_power_law_unaligned, 32768 },
-    { "4 bytes word aligned", test_aligned_4, 4 },
-    { "8 bytes word aligned", test_aligned_8, 8 },
-    { "16 bytes word aligned", test_aligned_16, 16 },
-    { "28 bytes word aligned", test_aligned_28, 28 },
-    { "32 bytes word aligned", test_aligned_32, 32 },
-    { "64 bytes word aligned", test_aligned_64, 64 },
-    { "128 bytes word aligned", test_aligned_128, 128 },
-    { "256 bytes word aligned", test_aligned_256, 256 },
-    { "3 bytes randomly aligned", test_unaligned_random_3, 3 },
-    { "8 bytes randomly aligned", test_unaligned_random_8, 8 },
-    { "17 bytes randomly aligned", test_unaligned_random_17, 17 },
-    { "28 bytes randomly aligned", test_unaligned_random_28, 28 },
-    { "64 bytes randomly aligned", test_unaligned_random_64, 64 },
-    { "137 bytes randomly aligned", test_unaligned_random_137, 137 },
-    { "1024 bytes randomly aligned", test_unaligned_random_1024, 1024 },
-    { "32768 bytes randomly aligned", test_unaligned_random_32768, 32768 },
-    { "1M bytes randomly aligned", test_unaligned_random_1M, 1024 * 1024 },
-    { "64 bytes randomly aligned, source aligned with dest",
+static void test_memmove_unaligned_random_32768_up(int i) {
+    memmove_moved(i, 32768, 0, memmove_distance(i));
+}
+
+static void test_memmove_unaligned_random_32768_down(int i) {
+    memmove_moved(i, 32768, 0, - memmove_distance(i));
+}
+
+static void test_memmove_page_aligned_1M_up(int i) {
+    memmove_moved(i, 1024 * 1024, 12, 4096);
+}
+
+static void test_memmove_page_aligned_1M_down(int i) {
+    memmove_moved(i, 1024 * 1024, 12, - 4096);
+}
+
+static void test_memmove_unaligned_random_1024_no_overlap(int i) {
+    memmove_moved(i, 1024, 0, 8192 + memmove_distance(i));
+}
+
+/*
+ * Copy and checksum tests, with packet sizes. The source is offset by
+ * source_offset bytes from the alignment given by align_shift.
+ */
+static inline void csum_copy_at(int i, int size, int align_shift,
+int source_offset) {
+    csum_copy_func(buffer_page +
+        (random_buffer_1024[(i * 2) & (RANDOM_BUFFER_SIZE - 1)] << align_shift),
+        buffer_page + 8192 * 1024 + source_offset +
+        (random_buffer_1024[(i * 2 + 1) & (RANDOM_BUFFER_SIZE - 1)] << align_shift),
+        size, 0);
+}
+
+static void test_csum_mixed_power_law_unaligned(int i) {
+    csum_copy_func(buffer_page + random_buffer_1M[(i * 2) & (RANDOM_BUFFER_SIZE - 1)],
+        buffer_page + 8192 * 1024 + random_buffer_1M[(i * 2 + 1) & (RANDOM_BUFFER_SIZE - 1)],
+        random_buffer_up_to_1023_power_law[i & (RANDOM_BUFFER_SIZE - 1)], 0);
+}
+
+static void test_csum_aligned_64(int i) {
+    csum_copy_at(i, 64, 2, 0);
+}
+
+static void test_csum_aligned_1500(int i) {
+    csum_copy_at(i, 1500, 2, 0);
+}
+
+static void test_csum_source_offset_2_1500(int i) {
+    csum_copy_at(i, 1500, 2, 2);
+}
+
+static void test_csum_unaligned_random_1500(int i) {
+    csum_copy_at(i, 1500, 0, 0);
+}
+
+static void test_csum_page_aligned_4096(int i) {
+    csum_copy_at(i, 4096, 12, 0);
+}
+
+static void test_csum_aligned_9000(int i) {
+    csum_copy_at(i, 9000, 2, 0);
+}
+
+static void test_csum_aligned_65536(int i) {
+    csum_copy_at(i, 65536, 2, 0);
+}
+
+/*
+ * Copy and CRC tests, with block sizes from 64 bytes to 1 MB. The source
+ * is 8 MB beyond the destination so that the buffers don't overlap.
+ */
+static inline void crc_copy_at(int i, int size, int align_shift) {
+    crc_copy_func(buffer_page +
+        (random_buffer_1024[(i * 2) & (RANDOM_BUFFER_SIZE - 1)] << align_shift),
+        buffer_page + 8192 * 1024 +
+        (random_buffer_1024[(i * 2 + 1) & (RANDOM_BUFFER_SIZE - 1)] << align_shift),
+        size, 0xFFFFFFFF);
+}
+
+static void test_crc_aligned_64(int i) {
+    crc_copy_at(i, 64, 2);
+}
+
+static void test_crc_aligned_256(int i) {
+    crc_copy_at(i, 256, 2);
+}
+
+static void test_crc_aligned_1024(int i) {
+    crc_copy_at(i, 1024, 2);
+}
+
+static void test_crc_page_aligned_4096(int i) {
+    crc_copy_at(i, 4096, 12);
+}
+
+static void test_crc_unaligned_random_4096(int i) {
+    crc_copy_at(i, 4096, 0);
+}
+
+static void test_crc_aligned_16384(int i) {
+    crc_copy_at(i, 16384, 2);
+}
+
+static void test_crc_aligned_65536(int i) {
+    crc_copy_at(i, 65536, 2);
+}
+
+static void test_crc_aligned_262144(int i) {
+    crc_copy_at(i, 262144, 2);
+}
+
+static void test_crc_aligned_1M(int i) {
+    crc_copy_at(i, 1024 * 1024, 2);
+}
+
+#ifndef HOST
+/*
+ * The exception table emitted by the user_access macro of kernel_defines.h.
+ * Both addresses are relative to the field that holds them.
+ */
+typedef struct {
+    int32_t insn;
+    int32_t fixup;
+} exception_table_entry_t;
+
+extern const exception_table_entry_t __start___ex_table[];
+extern const exception_table_entry_t __stop___ex_table[];
+
+/* The IT state bits of the CPSR. */
+#define PSR_IT_MASK 0x0600FC00
+#endif
+
+/* Set by the fault handler when a user copy was redirected to its fixup. */
+__thread volatile int uaccess_faulted;
+#ifdef HOST
+__thread sigjmp_buf uaccess_recovery;
+__thread volatile int uaccess_recovery_armed;
+__thread uint8_t *volatile uaccess_fault_address;
+#endif
+
+/*
+ * On ARM, continue at the fixup code of the faulting user access, which
+ * returns the number of bytes not copied, like the kernel's
+ * do_page_fault() does through fixup_exception(). The C copy code of the
+ * host backend has no exception table, so return to the recovery point in
+ * copy_user_fault() instead. Any other fault is fatal.
+ */
+static void uaccess_fault_handler(int sig, siginfo_t *info, void *context) {
+#ifdef HOST
+    if (uaccess_recovery_armed) {
+        uaccess_recovery_armed = 0;
+        uaccess_fault_address = info->si_addr;
+        siglongjmp(uaccess_recovery, 1);
+    }
+#else
+    ucontext_t *uc = context;
+    uintptr_t pc = uc->uc_mcontext.arm_pc;
+    for (const exception_table_entry_t *e = __start___ex_table;
+    e < __stop___ex_table; e++)
+        if ((uintptr_t)&e->insn + e->insn == pc) {
+            uc->uc_mcontext.arm_pc = (uintptr_t)&e->fixup + e->fixup;
+            uc->uc_mcontext.arm_cpsr &= ~PSR_IT_MASK;
+            uaccess_faulted = 1;
+            return;
+        }
+#endif
+    signal(SIGSEGV, SIG_DFL);
+}
+
+static uint8_t *fault_guard_page(int i) {
+    return fault_region + (size_t)(i + 1) * FAULT_GUARD_STRIDE - PAGE_SZ;
+}
+
+static int init_fault_injection() {
+    fault_region = mmap(NULL, (size_t)FAULT_NU_GUARD_PAGES * FAULT_GUARD_STRIDE,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (fault_region == MAP_FAILED)
+        return 0;
+    for (int i = 0; i < FAULT_NU_GUARD_PAGES; i++)
+        if (mprotect(fault_guard_page(i), PAGE_SZ, PROT_NONE) < 0)
+            return 0;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = uaccess_fault_handler;
+    sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    return sigaction(SIGSEGV, &sa, NULL) == 0;
+}
+
+/*
+ * Copy with the current fault mode variant and return the number of bytes
+ * not copied. user is the user side of the copy, the source for
+ * copy_from_user and the destination for copy_to_user.
+ */
+static size_t copy_user_fault(void *dest, const void *src, size_t n,
+uint8_t *user) {
+#ifdef HOST
+    if (sigsetjmp(uaccess_recovery, 0)) {
+        /*
+         * Like the kernel's copy_user_handle_tail(), copy what is left
+         * up to the faulting page.
+         */
+        size_t copied = ((uintptr_t)uaccess_fault_address &
+            ~(uintptr_t)(PAGE_SZ - 1)) - (uintptr_t)user;
+        memcpy(dest, src, copied);
+        return n - copied;
+    }
+    uaccess_recovery_armed = 1;
+    memcpy_func(dest, src, n);
+    uaccess_recovery_armed = 0;
+    return 0;
+#else
+    uaccess_faulted = 0;
+    void *r = memcpy_func(dest, src, n);
+    return uaccess_faulted ? (size_t)r : 0;
+#endif
+}
+
+/*
+ * User copy tests. When fault is set, the user buffer runs into a guard
+ * page at a random offset within the copy, otherwise the guard page is
+ * beyond its end.
+ */
+static inline void fault_copy_at(int i, int size, int align_shift, int fault) {
+    int r = random_buffer_1M[i & (RANDOM_BUFFER_SIZE - 1)];
+    int offset = fault ? (r >> 4) % size : size + (r & 255);
+    offset &= ~((1 << align_shift) - 1);
+    uint8_t *user = fault_guard_page(r & (FAULT_NU_GUARD_PAGES - 1)) - offset;
+    uint8_t *kernel = buffer_page +
+        (random_buffer_1024[i & (RANDOM_BUFFER_SIZE - 1)] << align_shift);
+    if (fault_to_user)
+        copy_user_fault(user, kernel, size, user);
+    else
+        copy_user_fault(kernel, user, size, user);
+}
+
+static void test_fault_aligned_256_no_fault(int i) {
+    fault_copy_at(i, 256, 2, 0);
+}
+
+static void test_fault_aligned_256(int i) {
+    fault_copy_at(i, 256, 2, 1);
+}
+
+static void test_fault_aligned_4096_no_fault(int i) {
+    fault_copy_at(i, 4096, 2, 0);
+}
+
+static void test_fault_aligned_4096(int i) {
+    fault_copy_at(i, 4096, 2, 1);
+}
+
+static void test_fault_unaligned_random_4096(int i) {
+    fault_copy_at(i, 4096, 0, 1);
+}
+
+static void test_fault_aligned_65536(int i) {
+    fault_copy_at(i, 65536, 2, 1);
+}
+
+/*
+ * Page-aligned move tests. The data moves between the blocks in the first
+ * 16 MB of the buffer and the ones in the second 16 MB, all blocks in one
+ * direction and then back, so that the remap front end always moves pages
+ * with data in them. The number of blocks is limited so that the mappings
+ * that the remapping splits off stay few.
+ */
+static inline void remap_at(int i, int size) {
+    int nu_blocks = 16 * 1024 * 1024 / size;
+    if (nu_blocks > 256)
+        nu_blocks = 256;
+    uint8_t *a = buffer_page + (i % nu_blocks) * size;
+    uint8_t *b = a + 16 * 1024 * 1024;
+    if ((i / nu_blocks) & 1)
+        memcpy_func(a, b, size);
+    else
+        memcpy_func(b, a, size);
+}
+
+static void test_remap_page_aligned_4096(int i) {
+    remap_at(i, 4096);
+}
+
+static void test_remap_page_aligned_16384(int i) {
+    remap_at(i, 16384);
+}
+
+static void test_remap_page_aligned_65536(int i) {
+    remap_at(i, 65536);
+}
+
+static void test_remap_page_aligned_256K(int i) {
+    remap_at(i, 256 * 1024);
+}
+
+static void test_remap_page_aligned_1M(int i) {
+    remap_at(i, 1024 * 1024);
+}
+
+static void test_remap_page_aligned_2M(int i) {
+    remap_at(i, 2 * 1024 * 1024);
+}
+
+static void test_remap_page_aligned_8M(int i) {
+    remap_at(i, 8 * 1024 * 1024);
+}
+
+/*
+ * Batched copy tests. The descriptors replay the sizes of
+ * random_buffer_multiples_of_four_up_to_1024_power_law, and each batch
+ * gathers its sources into consecutive bytes at the start of the buffer,
+ * the way a message is assembled from its pieces. The sources lie from
+ * 64 KB into the buffer, within 4 KB or scattered over up to 4 MB.
+ */
+static void init_vec_descs() {
+    vec_descs_in_cache = malloc(sizeof(struct copy_desc) * RANDOM_BUFFER_SIZE);
+    vec_descs_scattered = malloc(sizeof(struct copy_desc) * RANDOM_BUFFER_SIZE);
+    vec_descs_unaligned = malloc(sizeof(struct copy_desc) * RANDOM_BUFFER_SIZE);
+    int offset = 0;
+    for (int i = 0; i < RANDOM_BUFFER_SIZE; i++) {
+        if (i % VEC_BATCH_SIZE == 0)
+            offset = 0;
+        size_t n = random_buffer_multiples_of_four_up_to_1024_power_law[i];
+        uint8_t *sources = buffer_page + 65536;
+        vec_descs_in_cache[i].dest = buffer_page + offset;
+        vec_descs_in_cache[i].src = sources + random_buffer_1024[i] * 4;
+        vec_descs_in_cache[i].n = n;
+        vec_descs_scattered[i].dest = buffer_page + offset;
+        vec_descs_scattered[i].src = sources + random_buffer_1M[i] * 4;
+        vec_descs_scattered[i].n = n;
+        vec_descs_unaligned[i].dest = buffer_page + offset + 1;
+        vec_descs_unaligned[i].src = sources + random_buffer_1M[i];
+        vec_descs_unaligned[i].n = n;
+        offset += n;
+    }
+}
+
+static inline void vec_at(const struct copy_desc *descs, int batch_size,
+int i) {
+    vec_func(descs + ((i * batch_size) & (RANDOM_BUFFER_SIZE - 1)),
+        batch_size);
+}
+
+static void test_vec_word_aligned_in_cache(int i) {
+    vec_at(vec_descs_in_cache, VEC_BATCH_SIZE, i);
+}
+
+static void test_vec_word_aligned_scattered(int i) {
+    vec_at(vec_descs_scattered, VEC_BATCH_SIZE, i);
+}
+
+static void test_vec_unaligned_scattered(int i) {
+    vec_at(vec_descs_unaligned, VEC_BATCH_SIZE, i);
+}
+
+static void test_vec_word_aligned_in_cache_batch_4(int i) {
+    vec_at(vec_descs_in_cache, 4, i);
+}
+
+/*
+ * Replay the next record of the trace. The source is mapped to the first
+ * half and the destination to the second half of the buffer, so that the
+ * address mapping is the same for every variant.
+ */
+static void test_trace_memcpy(int i) {
+    const trace_record_t *r = &trace_memcpy_records[trace_position];
+    memcpy_func(buffer_page + 2 * TRACE_WINDOW + r->dst_offset,
+        buffer_page + r->src_offset, r->size);
+    trace_position++;
+    if (trace_position == trace_nu_memcpy_records)
+        trace_position = 0;
+}
+
+static void test_trace_memset(int i) {
+    const trace_record_t *r = &trace_memset_records[trace_position];
+    memset_func(buffer_page + r->dst_offset, r->src_offset, r->size);
+    trace_position++;
+    if (trace_position == trace_nu_memset_records)
+        trace_position = 0;
+}
+
+/*
+ * Read a trace written by trace_shim.so and split it into memcpy and memset
+ * records. The bytes value of the trace tests is the average size of the
+ * calls. Returns 0 on error.
+ */
+static int load_trace(const char *file_name) {
+    struct stat st;
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        printf("Unable to open trace file %s.\n", file_name);
+        return 0;
+    }
+    if (st.st_size < sizeof(trace_header_t) ||
+    (st.st_size - sizeof(trace_header_t)) % sizeof(trace_record_t) != 0) {
+        printf("Invalid trace file.\n");
+        close(fd);
+        return 0;
+    }
+    uint8_t *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("Unable to map trace file %s.\n", file_name);
+        return 0;
+    }
+    const trace_header_t *header = (const trace_header_t *)map;
+    const trace_record_t *records = (const trace_record_t *)(map + sizeof(trace_header_t));
+    int nu_records = (st.st_size - sizeof(trace_header_t)) / sizeof(trace_record_t);
+    if (header->magic != TRACE_MAGIC || header->version != TRACE_VERSION) {
+        printf("Invalid trace file.\n");
+        munmap(map, st.st_size);
+        return 0;
+    }
+    trace_nu_memcpy_records = 0;
+    trace_nu_memset_records = 0;
+    for (int i = 0; i < nu_records; i++) {
+        uint32_t size = records[i].size & ~TRACE_MEMSET;
+        uint32_t src_limit = (records[i].size & TRACE_MEMSET) ? 256 : TRACE_WINDOW;
+        if (records[i].dst_offset >= TRACE_WINDOW || records[i].src_offset >= src_limit ||
+        size > TRACE_WINDOW) {
+            printf("Trace record %d out of range.\n", i);
+            munmap(map, st.st_size);
+            return 0;
+        }
+        if (records[i].size & TRACE_MEMSET)
+            trace_nu_memset_records++;
+        else
+            trace_nu_memcpy_records++;
+    }
+    trace_memcpy_records = malloc(sizeof(trace_record_t) * (trace_nu_memcpy_records + 1));
+    trace_memset_records = malloc(sizeof(trace_record_t) * (trace_nu_memset_records + 1));
+    long long memcpy_total_bytes = 0;
+    long long memset_total_bytes = 0;
+    int j = 0, k = 0;
+    for (int i = 0; i < nu_records; i++)
+        if (records[i].size & TRACE_MEMSET) {
+            trace_memset_records[k] = records[i];
+            trace_memset_records[k].size &= ~TRACE_MEMSET;
+            memset_total_bytes += trace_memset_records[k].size;
+            k++;
+        }
+        else {
+            trace_memcpy_records[j] = records[i];
+            memcpy_total_bytes += records[i].size;
+            j++;
+        }
+    munmap(map, st.st_size);
+    if (trace_nu_memcpy_records > 0)
+        trace_memcpy_bytes = (memcpy_total_bytes + trace_nu_memcpy_records / 2) /
+            trace_nu_memcpy_records;
+    if (trace_nu_memset_records > 0)
+        trace_memset_bytes = (memset_total_bytes + trace_nu_memset_records / 2) /
+            trace_nu_memset_records;
+    return 1;
+}
+
+/*
+ * Parse a size with an optional K or M suffix. Returns - 1 on error,
+ * otherwise the size, with *end set to the character after it.
+ */
+static long parse_size(const char *str, char **end) {
+    long n = strtol(str, end, 10);
+    if (*end == str || n < 0)
+        return - 1;
+    if (**end == 'k' || **end == 'K') {
+        n *= 1024;
+        (*end)++;
+    }
+    else if (**end == 'm' || **end == 'M') {
+        n *= 1024 * 1024;
+        (*end)++;
+    }
+    return n;
+}
+
+/*
+ * Parse an alignment class: byte, word, chunk, line, page or a power of
+ * two, optionally followed by +<offset>.
+ */
+static int parse_alignment(const char *str, int *align, int *offset) {
+    static const struct { const char *name; int align; } classes[] = {
+        { "byte", 1 }, { "word", 4 }, { "chunk", 32 }, { "line", 64 },
+        { "page", 4096 }
+    };
+    char *end = (char *)str;
+    *align = 0;
+    *offset = 0;
+    for (int i = 0; i < sizeof(classes) / sizeof(classes[0]); i++)
+        if (strncmp(str, classes[i].name, strlen(classes[i].name)) == 0) {
+            *align = classes[i].align;
+            end = (char *)str + strlen(classes[i].name);
+        }
+    if (*align == 0)
+        *align = parse_size(str, &end);
+    if (*align <= 0 || *align > 4096 || (*align & (*align - 1)) != 0)
+        return 0;
+    if (*end == '+') {
+        *offset = strtol(end + 1, &end, 10);
+        if (*offset < 0 || *offset >= *align)
+            return 0;
+    }
+    return *end == '\0';
+}
+
+/*
+ * Parse a workload spec, a comma-separated list of key=value pairs (see
+ * usage()). Returns 0 on error.
+ */
+static int parse_workload(const char *spec, workload_t *w) {
+    char str[256], *saveptr, *end;
+    w->spec = spec;
+    w->size_distribution = - 1;
+    w->size_multiple = 1;
+    w->src_align = w->dst_align = 1;
+    w->src_offset = w->dst_offset = 0;
+    w->region = DEFAULT_WORKLOAD_REGION;
+    w->pattern = PATTERN_RANDOM;
+    w->count = DEFAULT_WORKLOAD_COUNT;
+    w->seed = 0;
+    if (strlen(spec) >= sizeof(str))
+        return 0;
+    strcpy(str, spec);
+    for (char *key = strtok_r(str, ",", &saveptr); key != NULL;
+    key = strtok_r(NULL, ",", &saveptr)) {
+        char *value = strchr(key, '=');
+        if (value == NULL)
+            return 0;
+        *value++ = '\0';
+        if (strcmp(key, "size") == 0) {
+            w->size_min = parse_size(value, &end);
+            w->size_max = w->size_min;
+            w->size_distribution = SIZE_FIXED;
+            if (*end == '-') {
+                w->size_max = parse_size(end + 1, &end);
+                w->size_distribution = SIZE_UNIFORM;
+                if (strcmp(end, ":pow2") == 0) {
+                    w->size_distribution = SIZE_POW2;
+                    end += strlen(end);
+                }
+                else if (strcmp(end, ":powerlaw") == 0) {
+                    w->size_distribution = SIZE_POWER_LAW;
+                    end += strlen(end);
+                }
+            }
+            if (*end != '\0' || w->size_min < 1 || w->size_max < w->size_min)
+                return 0;
+        }
+        else if (strcmp(key, "mult") == 0) {
+            w->size_multiple = strtol(value, &end, 10);
+            if (*end != '\0' || w->size_multiple < 1)
+                return 0;
+        }
+        else if (strcmp(key, "align") == 0) {
+            if (!parse_alignment(value, &w->src_align, &w->src_offset))
+                return 0;
+            w->dst_align = w->src_align;
+            w->dst_offset = w->src_offset;
+        }
+        else if (strcmp(key, "src") == 0) {
+            if (!parse_alignment(value, &w->src_align, &w->src_offset))
+                return 0;
+        }
+        else if (strcmp(key, "dst") == 0) {
+            if (!parse_alignment(value, &w->dst_align, &w->dst_offset))
+                return 0;
+        }
+        else if (strcmp(key, "region") == 0) {
+            w->region = parse_size(value, &end);
+            if (*end != '\0' || w->region < 1 || w->region > WORKLOAD_MAX_REGION)
+                return 0;
+        }
+        else if (strcmp(key, "pattern") == 0) {
+            if (strcmp(value, "random") == 0)
+                w->pattern = PATTERN_RANDOM;
+            else if (strcmp(value, "sequential") == 0)
+                w->pattern = PATTERN_SEQUENTIAL;
+            else if (strcmp(value, "fixed") == 0)
+                w->pattern = PATTERN_FIXED;
+            else
+                return 0;
+        }
+        else if (strcmp(key, "count") == 0) {
+            w->count = strtol(value, &end, 10);
+            if (*end != '\0' || w->count < 1 || w->count > WORKLOAD_MAX_COUNT)
+                return 0;
+        }
+        else if (strcmp(key, "seed") == 0) {
+            w->seed = strtoul(value, &end, 10);
+            if (*end != '\0')
+                return 0;
+        }
+        else
+            return 0;
+    }
+    if (w->size_distribution < 0 || w->size_multiple > w->size_max)
+        return 0;
+    if (w->size_distribution == SIZE_POW2) {
+        int p = 1;
+        while (p < w->size_min)
+            p *= 2;
+        if (p > w->size_max)
+            return 0;
+    }
+    /* The largest call must fit in the regions at every offset. */
+    return w->size_max + w->src_offset <= w->region &&
+        w->size_max + w->dst_offset <= w->region;
+}
+
+/* Read workload specs from a file, one per line. Returns 0 on error. */
+static int load_workload_file(const char *file_name) {
+    char line[256];
+    FILE *f = fopen(file_name, "r");
+    if (f == NULL) {
+        printf("Unable to open workload file %s.\n", file_name);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "#\r\n")] = '\0';
+        char *spec = line + strspn(line, " \t");
+        spec[strcspn(spec, " \t")] = '\0';
+        if (spec[0] == '\0')
+            continue;
+        if (nu_workloads == MAX_WORKLOADS) {
+            printf("Too many workloads.\n");
+            fclose(f);
+            return 0;
+        }
+        spec = strdup(spec);
+        if (!parse_workload(spec, &workload[nu_workloads])) {
+            printf("Invalid workload spec %s.\n", spec);
+            fclose(f);
+            return 0;
+        }
+        nu_workloads++;
+    }
+    fclose(f);
+    return 1;
+}
+
+static int workload_size(const workload_t *w, unsigned int *seed) {
+    int size = w->size_min;
+    int range = w->size_max - w->size_min + 1;
+    double f = (double)rand_r(seed) / RAND_MAX;
+    switch (w->size_distribution) {
+    case SIZE_UNIFORM:
+        size = w->size_min + rand_r(seed) % range;
+        break;
+    case SIZE_POW2: {
+        int lo = 0, hi = 0;
+        while ((1 << lo) < w->size_min)
+            lo++;
+        while (hi < 30 && (2 << hi) <= w->size_max)
+            hi++;
+        size = 1 << (lo + rand_r(seed) % (hi - lo + 1));
+        break;
+    }
+    case SIZE_POWER_LAW:
+        /* Like random_buffer_up_to_1023_power_law, scaled to the range. */
+        size = w->size_min + (int)floor(range * (pow(2.0, 10.0 * f) - 1.0) /
+            (pow(2.0, 10.0) - 1.0));
+        if (size > w->size_max)
+            size = w->size_max;
+        break;
+    }
+    size -= size % w->size_multiple;
+    if (size < w->size_multiple)
+        size = w->size_multiple;
+    return size;
+}
+
+/*
+ * The offset of the next call in a region, a multiple of align plus
+ * offset. *position is the end of the previous call for the sequential
+ * pattern.
+ */
+static int workload_offset(const workload_t *w, int align, int offset,
+int size, int *position, unsigned int *seed) {
+    int o;
+    switch (w->pattern) {
+    case PATTERN_RANDOM:
+        return rand_r(seed) % ((w->region - size - offset) / align + 1) *
+            align + offset;
+    case PATTERN_SEQUENTIAL:
+        o = (*position + align - 1) / align * align + offset;
+        if (o + size > w->region)
+            o = offset;
+        *position = o + size;
+        return o;
+    default:
+        return offset;
+    }
+}
+
+/*
+ * Generate the calls of a workload into a flat array of (dest, src, n)
+ * triples for the current thread's buffer. Returns the total number of
+ * bytes, or - 1 when it doesn't fit in an int.
+ */
+static int generate_workload(const workload_t *w, struct copy_desc *descs) {
+    unsigned int seed = w->seed;
+    int src_position = 0, dst_position = 0;
+    long long total_bytes = 0;
+    for (int i = 0; i < w->count; i++) {
+        int size = workload_size(w, &seed);
+        descs[i].src = buffer_page + workload_offset(w, w->src_align,
+            w->src_offset, size, &src_position, &seed);
+        descs[i].dest = buffer_page + WORKLOAD_DEST_OFFSET + workload_offset(w,
+            w->dst_align, w->dst_offset, size, &dst_position, &seed);
+        descs[i].n = size;
+        total_bytes += size;
+    }
+    return total_bytes > 0x7FFFFFFF ? - 1 : (int)total_bytes;
+}
+
+/*
+ * The workload tests, one pass over the generated calls in a loop without
+ * any per-call index arithmetic.
+ */
+static void test_workload_memcpy(int i) {
+    memcpy_func_type func = memcpy_func;
+    for (const struct copy_desc *d = workload_descs; d < workload_descs_end;
+    d++)
+        func(d->dest, d->src, d->n);
+}
+
+static void test_workload_memset(int i) {
+    memset_func_type func = memset_func;
+    for (const struct copy_desc *d = workload_descs; d < workload_descs_end;
+    d++)
+        func(d->dest, 0, d->n);
+}
+
+/*
+ * Read and write every 32 bytes, the smallest cache line size of the
+ * supported CPUs, of the first 32 MB of the buffer.
+ */
+static void clear_data_cache() {
+    int val = 0;
+    for (int i = 0; i < 1024 * 1024 * 32; i += 32) {
+        val += buffer_alloc[i];
+    }
+    for (int i = 0; i < 1024 * 1024 * 32; i += 32) {
+        buffer_alloc[i] = val;
+    }
+}
+
+static int get_nu_iterations(int bytes) {
+    if (bytes >= 64 * 1024 * 1024)
+        return 1;
+    else if (bytes >= 1024) 
+        return (64 * 1024 * 1024) / bytes;
+    else if (bytes >= 64)
+        return (16 * 1024 * 1024) / bytes;
+    else
+        return 1024 * 1024 / 2;
+}
+
+/* Run the timed loop for test_duration seconds and return the bandwidth. */
+static double measure_bandwidth(void (*test_func)(int), int bytes,
+int nu_iterations, long long *calls, double *duration) {
+    double start_time = get_time();
+    double end_time;
+    int count = 0;
+    for (;;) {
+        for (int i = 0; i < nu_iterations; i++)
+            test_func(i);
+        count++;
+        end_time = get_time();
+        if (end_time - start_time >= test_duration)
+            break;
+    }
+    *calls = (long long)nu_iterations * count;
+    *duration = end_time - start_time;
+    return (double)bytes * nu_iterations * count / (1024 * 1024)
+        / (end_time - start_time);
+}
+
+/*
+ * Record the calls of a memcpy or memset test into the operation streams
+ * by running it with functions that only store their arguments. The tests
+ * repeat after RANDOM_BUFFER_SIZE calls, so the streams cover them.
+ */
+static void *record_memcpy(void *dest, const void *src, size_t n) {
+    if (stream_nu_ops < STREAM_LENGTH) {
+        stream_dest[stream_nu_ops] = dest;
+        stream_src[stream_nu_ops] = src;
+        stream_size[stream_nu_ops] = n;
+        stream_nu_ops++;
+    }
+    return dest;
+}
+
+static void *record_memset(void *dest, int c, size_t n) {
+    stream_is_memset = 1;
+    if (stream_nu_ops < STREAM_LENGTH) {
+        stream_dest[stream_nu_ops] = dest;
+        stream_value[stream_nu_ops] = c;
+        stream_size[stream_nu_ops] = n;
+        stream_nu_ops++;
+    }
+    return dest;
+}
+
+/* The empty functions for the baseline replay. */
+static void * __attribute__((noinline)) empty_memcpy(void *dest,
+const void *src, size_t n) {
+    return dest;
+}
+
+static void * __attribute__((noinline)) empty_memset(void *dest, int c,
+size_t n) {
+    return dest;
+}
+
+/* The timed loops of stream mode, one pass over the streams per call. */
+static void test_stream_memcpy(int i) {
+    memcpy_func_type func = memcpy_func;
+    for (int k = 0; k < stream_nu_ops; k++)
+        func(stream_dest[k], stream_src[k], stream_size[k]);
+}
+
+static void test_stream_memset(int i) {
+    memset_func_type func = memset_func;
+    for (int k = 0; k < stream_nu_ops; k++)
+        func(stream_dest[k], stream_value[k], stream_size[k]);
+}
+
+/*
+ * Record the streams of a test and calibrate the baseline: the fastest
+ * of STREAM_CALIBRATION_RUNS replays with the empty functions. For large
+ * sizes the replay is limited to the calls that fit in STREAM_MAX_BYTES.
+ * Returns 0 if the test doesn't make STREAM_LENGTH memcpy or memset calls.
+ */
+static int prepare_stream(void (*test_func)(int)) {
+    memcpy_func_type saved_memcpy = memcpy_func;
+    memset_func_type saved_memset = memset_func;
+    memcpy_func = record_memcpy;
+    memset_func = record_memset;
+    stream_nu_ops = 0;
+    stream_is_memset = 0;
+    for (int i = 0; i < STREAM_LENGTH && stream_nu_ops < STREAM_LENGTH; i++)
+        test_func(i);
+    if (stream_nu_ops < STREAM_LENGTH) {
+        memcpy_func = saved_memcpy;
+        memset_func = saved_memset;
+        return 0;
+    }
+    stream_bytes = 0;
+    for (int k = 0; k < STREAM_LENGTH; k++) {
+        if (k > 0 && stream_bytes + stream_size[k] > STREAM_MAX_BYTES) {
+            stream_nu_ops = k;
+            break;
+        }
+        stream_bytes += stream_size[k];
+    }
+    memcpy_func = empty_memcpy;
+    memset_func = empty_memset;
+    stream_baseline_ns = 0;
+    for (int r = 0; r < STREAM_CALIBRATION_RUNS; r++) {
+        uint64_t start = get_time_ns();
+        for (int i = 0; i < STREAM_CALIBRATION_PASSES; i++)
+            if (stream_is_memset)
+                test_stream_memset(i);
+            else
+                test_stream_memcpy(i);
+        double ns = (double)(get_time_ns() - start) /
+            ((double)STREAM_CALIBRATION_PASSES * stream_nu_ops);
+        if (r == 0 || ns < stream_baseline_ns)
+            stream_baseline_ns = ns;
+    }
+    memcpy_func = saved_memcpy;
+    memset_func = saved_memset;
+    return 1;
+}
+
+/*
+ * Latency histogram with logarithmic buckets, each divided into
+ * HISTOGRAM_SUB_BUCKETS linear sub-buckets (HDR histogram style). Values
+ * below HISTOGRAM_SUB_BUCKETS are recorded exactly; larger values with a
+ * relative precision of 1 / HISTOGRAM_SUB_BUCKETS.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_NU_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t count[HISTOGRAM_NU_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} histogram_t;
+
+static int histogram_index(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return value;
+    int e = 63 - __builtin_clzll(value);
+    return (e - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS +
+        ((value >> (e - HISTOGRAM_SUB_BUCKET_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/* Return the midpoint of the range of values recorded in a bucket. */
+static double histogram_bucket_value(int index) {
+    if (index < HISTOGRAM_SUB_BUCKETS)
+        return index;
+    int e = index / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKET_BITS - 1;
+    int sub = index & (HISTOGRAM_SUB_BUCKETS - 1);
+    double width = (double)((uint64_t)1 << (e - HISTOGRAM_SUB_BUCKET_BITS));
+    return (HISTOGRAM_SUB_BUCKETS + sub) * width + width / 2;
+}
+
+static void histogram_record(histogram_t *h, uint64_t value) {
+    h->count[histogram_index(value)]++;
+    h->total++;
+    if (value > h->max)
+        h->max = value;
+}
+
+static double histogram_percentile(const histogram_t *h, double percentile) {
+    uint64_t target = ceil(percentile / 100.0 * h->total);
+    uint64_t count = 0;
+    if (target < 1)
+        target = 1;
+    for (int i = 0; i < HISTOGRAM_NU_BUCKETS; i++) {
+        count += h->count[i];
+        if (count >= target) {
+            double value = histogram_bucket_value(i);
+            return value > h->max ? h->max : value;
+        }
+    }
+    return h->max;
+}
+
+/*
+ * Time the test in batches of LATENCY_BATCH_SIZE calls for test_duration
+ * seconds and record the duration of each batch, minus the overhead of
+ * reading the clock, in the histogram.
+ */
+static void measure_latency(void (*test_func)(int), int nu_iterations,
+histogram_t *h) {
+    /* Calibrate the overhead of a pair of clock reads (minimum of 1000). */
+    uint64_t overhead = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t t0 = get_time_ns();
+        uint64_t t1 = get_time_ns();
+        if (t1 - t0 < overhead)
+            overhead = t1 - t0;
+    }
+    memset(h, 0, sizeof(histogram_t));
+    double start_time = get_time();
+    /*
+     * The call index restarts with every pass, as in measure_bandwidth(),
+     * so that it can't overflow however long the test runs.
+     */
+    for (;;) {
+        for (int j = 0; j < nu_iterations; j += LATENCY_BATCH_SIZE) {
+            uint64_t t0 = get_time_ns();
+            for (int k = 0; k < LATENCY_BATCH_SIZE; k++)
+                test_func(j + k);
+            uint64_t t1 = get_time_ns();
+            histogram_record(h, t1 - t0 > overhead ? t1 - t0 - overhead : 0);
+        }
+        if (get_time() - start_time >= test_duration)
+            break;
+    }
+}
+
+/*
+ * Read one word of every 32 bytes (the smallest cache line size) of the
+ * victim buffer and return the time taken in ns.
+ */
+static uint64_t victim_pass() {
+    uint32_t sum = 0;
+    uint64_t t0 = get_time_ns();
+    for (int i = 0; i < victim_kb * 1024; i += 32)
+        sum += *(volatile uint32_t *)(victim_buffer + i);
+    uint64_t t1 = get_time_ns();
+    victim_sink = sum;
+    return t1 - t0;
+}
+
+/*
+ * Measure the collateral damage of the test on the cache: the average time
+ * of a pass over the cache-resident victim buffer, on its own and after
+ * each call of the test function, each for half of test_duration.
+ */
+static void measure_victim(void (*test_func)(int), double *alone,
+double *after) {
+    uint64_t total = 0;
+    int count = 0;
+    victim_pass();
+    double start_time = get_time();
+    do {
+        total += victim_pass();
+        count++;
+    } while (get_time() - start_time < test_duration / 2);
+    *alone = (double)total / count;
+    total = 0;
+    count = 0;
+    start_time = get_time();
+    do {
+        test_func(count);
+        total += victim_pass();
+        count++;
+    } while (get_time() - start_time < test_duration / 2);
+    *after = (double)total / count;
+}
+
+/*
+ * Read the level, type and size in bytes of cache index i of CPU 0 from
+ * sysfs. Returns 0 when there is no such cache.
+ */
+static int read_cache_info(int i, int *level, char *type, int type_size,
+int *size) {
+    char path[128], str[32], *end;
+    const char *field[3] = { "level", "type", "size" };
+    *level = 0;
+    *size = 0;
+    type[0] = '\0';
+    for (int f = 0; f < 3; f++) {
+        snprintf(path, sizeof(path),
+            "/sys/devices/system/cpu/cpu0/cache/index%d/%s", i, field[f]);
+        FILE *file = fopen(path, "r");
+        if (file == NULL)
+            return f > 0;
+        if (fgets(str, sizeof(str), file) == NULL)
+            str[0] = '\0';
+        fclose(file);
+        str[strcspn(str, "\n")] = '\0';
+        if (f == 0)
+            *level = atoi(str);
+        else if (f == 1)
+            snprintf(type, type_size, "%s", str);
+        else if ((*size = parse_size(str, &end)) < 0)
+            *size = 0;
+    }
+    return 1;
+}
+
+/*
+ * The size of the largest data or unified cache (the last level cache),
+ * or with level_1 set, of the L1 data or instruction cache. Returns 0 if
+ * unknown.
+ */
+static int get_cache_size(int level_1, int instruction) {
+    int level, size, max = 0;
+    char type[32];
+    for (int i = 0; read_cache_info(i, &level, type, sizeof(type), &size); i++) {
+        if ((strcmp(type, "Instruction") == 0) != instruction)
+            continue;
+        if (level_1 && level != 1)
+            continue;
+        if (size > max)
+            max = size;
+    }
+    return max;
+}
+
+/*
+ * Set up the eviction of cold or l2 mode: the eviction buffer, a block of
+ * no-ops twice the size of the L1 instruction cache followed by a return,
+ * and the overhead of the timestamps. The instruction cache is only
+ * evicted on the architectures whose no-op and return encodings are known
+ * here. Returns 0 on error.
+ */
+static int init_cache_eviction() {
+    int cache_size = cache_mode == CACHE_COLD ? get_cache_size(0, 0) :
+        get_cache_size(1, 0);
+    if (cache_size == 0)
+        cache_size = cache_mode == CACHE_COLD ? DEFAULT_LLC_SIZE :
+            DEFAULT_L1_SIZE;
+    evict_size = 2 * (size_t)cache_size;
+    evict_buffer = mmap(NULL, evict_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, - 1, 0);
+    if (evict_buffer == MAP_FAILED)
+        return 0;
+    madvise(evict_buffer, evict_size, MADV_NOHUGEPAGE);
+    memset(evict_buffer, 1, evict_size);
+#if defined(__i386__) || defined(__x86_64__) || defined(__arm__) || defined(__aarch64__)
+    int code_size = get_cache_size(1, 1);
+    if (code_size == 0)
+        code_size = DEFAULT_L1_SIZE / 2;
+    code_size *= 2;
+    uint8_t *code = mmap(NULL, code_size + 4096, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, - 1, 0);
+    if (code == MAP_FAILED)
+        return 0;
+#if defined(__i386__) || defined(__x86_64__)
+    memset(code, 0x90, code_size);
+    code[code_size] = 0xC3;
+#else
+    for (int i = 0; i <= code_size; i += 4)
+#ifdef __aarch64__
+        *(uint32_t *)(code + i) = i < code_size ? 0xD503201F : 0xD65F03C0;
+#else
+        /* mov r0, r0 and bx lr in ARM state, which blx switches to. */
+        *(uint32_t *)(code + i) = i < code_size ? 0xE1A00000 : 0xE12FFF1E;
+#endif
+#endif
+    if (mprotect(code, code_size + 4096, PROT_READ | PROT_EXEC) == 0) {
+        __builtin___clear_cache((char *)code, (char *)code + code_size + 4);
+        evict_code = code;
+    }
+#endif
+    timer_overhead_ns = ~(uint64_t)0;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t t0 = get_time_ns();
+        uint64_t t1 = get_time_ns();
+        if (t1 - t0 < timer_overhead_ns)
+            timer_overhead_ns = t1 - t0;
+    }
+    return 1;
+}
+
+static void evict_caches() {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < evict_size; i += 32)
+        sum += *(volatile uint8_t *)(evict_buffer + i);
+    evict_sink = sum;
+    if (evict_code != NULL)
+        ((void (*)(void))evict_code)();
+}
+
+/*
+ * Measure the bandwidth with the caches evicted before every batch of
+ * cache_batch calls. Only the batches are timed, less the overhead of the
+ * timestamps; the eviction passes are timed separately, and their average
+ * is returned in *evict_us. Runs for test_duration seconds including the
+ * evictions, but for at least MIN_COLD_BATCHES batches.
+ */
+static double measure_cold(void (*test_func)(int), int bytes,
+double *evict_us) {
+    uint64_t batch_ns = 0, evict_ns = 0;
+    int count = 0, i = 0;
+    double start_time = get_time();
+    for (;;) {
+        uint64_t t0 = get_time_ns();
+        evict_caches();
+        uint64_t t1 = get_time_ns();
+        for (int k = 0; k < cache_batch; k++)
+            test_func(i++);
+        uint64_t t2 = get_time_ns();
+        evict_ns += t1 - t0;
+        if (t2 - t1 > timer_overhead_ns)
+            batch_ns += t2 - t1 - timer_overhead_ns;
+        count++;
+        if (count >= MIN_COLD_BATCHES && get_time() - start_time >= test_duration)
+            break;
+    }
+    *evict_us = (double)evict_ns / 1000.0 / count;
+    if (batch_ns == 0)
+        batch_ns = 1;
+    return (double)bytes * cache_batch * count / (1024 * 1024) /
+        ((double)batch_ns / 1000000000.0);
+}
+
+/*
+ * Hardware event counters in counters mode, counted in user space for the
+ * calling thread while measure_bandwidth() runs, minus the events of its
+ * timing loop. The counters are opened
+ * one by one rather than as a group, so that an event the PMU doesn't
+ * support doesn't take the others with it; their values are scaled for the
+ * time they were scheduled when the kernel multiplexes them.
+ */
+typedef struct {
+    /* The name in text output and the key in JSON and CSV output. */
+    const char *name;
+    const char *key;
+    uint32_t type;
+    uint64_t config;
+} counter_t;
+
+static const counter_t counter[NU_COUNTERS] = {
+    { "cycles", "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", "instructions", PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_INSTRUCTIONS },
+    /* Read misses, the L1D miss event that PMUs generally provide. */
+    { "L1D misses", "l1d_misses", PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { "LLC misses", "llc_misses", PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_CACHE_MISSES },
+    { "branch misses", "branch_misses", PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_BRANCH_MISSES },
+    { "frontend stalls", "stalled_cycles_frontend", PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_STALLED_CYCLES_FRONTEND },
+    { "backend stalls", "stalled_cycles_backend", PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_STALLED_CYCLES_BACKEND },
+};
+
+static int counter_fd[NU_COUNTERS];
+
+/* Open the counters and return the number of them that are available. */
+static int open_counters() {
+    int nu_available = 0;
+    for (int i = 0; i < NU_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counter[i].type;
+        attr.config = counter[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+            PERF_FORMAT_TOTAL_TIME_RUNNING;
+        counter_fd[i] = syscall(__NR_perf_event_open, &attr, 0, - 1, - 1, 0);
+        if (counter_fd[i] >= 0)
+            nu_available++;
+    }
+    return nu_available;
+}
+
+static void start_counters() {
+    for (int i = 0; i < NU_COUNTERS; i++)
+        if (counter_fd[i] >= 0) {
+            ioctl(counter_fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+}
+
+/*
+ * Stop the counters and store their values in count, or - 1 for the ones
+ * that are unavailable or were never scheduled.
+ */
+static void stop_counters(double *count) {
+    for (int i = 0; i < NU_COUNTERS; i++)
+        if (counter_fd[i] >= 0)
+            ioctl(counter_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    for (int i = 0; i < NU_COUNTERS; i++) {
+        /* The value, the time enabled and the time running. */
+        uint64_t data[3];
+        count[i] = - 1;
+        if (counter_fd[i] < 0 ||
+        read(counter_fd[i], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+            continue;
+        count[i] = (double)data[0] * data[1] / data[2];
+    }
+}
+
+static void __attribute__((noinline)) empty_test(int i) {
+}
+
+/*
+ * Subtract the events of the timing loop of measure_bandwidth() (the loop
+ * and the get_time() calls) from count. They are counted by running the
+ * loop with an empty test function for up to COUNTER_BASELINE_CALLS calls
+ * and scaled to the calls of the measurement.
+ */
+static void subtract_counter_baseline(int nu_iterations, long long calls,
+double *count) {
+    double baseline[NU_COUNTERS];
+    long long batches = calls / nu_iterations;
+    long long baseline_batches = COUNTER_BASELINE_CALLS / nu_iterations;
+    if (baseline_batches < 1)
+        baseline_batches = 1;
+    if (baseline_batches > batches)
+        baseline_batches = batches;
+    start_counters();
+    for (long long b = 0; b < baseline_batches; b++) {
+        for (int i = 0; i < nu_iterations; i++)
+            empty_test(i);
+        get_time();
+    }
+    stop_counters(baseline);
+    for (int i = 0; i < NU_COUNTERS; i++)
+        if (count[i] >= 0 && baseline[i] >= 0) {
+            count[i] -= baseline[i] * batches / baseline_batches;
+            if (count[i] < 0)
+                count[i] = 0;
+        }
+}
+
+/*
+ * Return the size of a huge page, which is also the size of a transparent
+ * huge page on the supported architectures.
+ */
+static size_t get_huge_page_size() {
+    FILE *f = fopen("/proc/meminfo", "r");
+    char line[256];
+    size_t size = 2 * 1024 * 1024;
+    if (f == NULL)
+        return size;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        unsigned long kb;
+        if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+            size = (size_t)kb * 1024;
+            break;
+        }
+    }
+    fclose(f);
+    return size;
+}
+
+/*
+ * Parse a list such as "0-3,6" into values, each less than max_value.
+ * Returns the number of values, or 0 if the list is invalid or has more
+ * than max_values values.
+ */
+static int parse_list(const char *str, int *values, int max_values,
+int max_value) {
+    int n = 0;
+    while (*str != '\0' && *str != '\n') {
+        char *end;
+        int first = strtol(str, &end, 10);
+        int last = first;
+        if (end == str)
+            return 0;
+        if (*end == '-') {
+            str = end + 1;
+            last = strtol(str, &end, 10);
+            if (end == str)
+                return 0;
+        }
+        if (first < 0 || last < first || last >= max_value ||
+        last - first >= max_values - n)
+            return 0;
+        for (int i = first; i <= last; i++)
+            values[n++] = i;
+        if (*end == ',')
+            end++;
+        str = end;
+    }
+    return n;
+}
+
+/*
+ * Return the online NUMA nodes in nodes. A kernel without NUMA support has
+ * only node 0.
+ */
+static int get_numa_nodes(int *nodes) {
+    char line[256];
+    int n = 0;
+    FILE *f = fopen("/sys/devices/system/node/online", "r");
+    if (f != NULL) {
+        if (fgets(line, sizeof(line), f) != NULL)
+            n = parse_list(line, nodes, MAX_NUMA_NODES, MAX_NUMA_NODES);
+        fclose(f);
+    }
+    if (n == 0) {
+        nodes[0] = 0;
+        n = 1;
+    }
+    return n;
+}
+
+/*
+ * Bind the memory of a buffer that hasn't been touched yet to a NUMA node.
+ * On a machine with a single node the binding may fail (for example
+ * without NUMA support in the kernel), but is not needed either.
+ */
+static int bind_to_node(void *p, size_t size, int node) {
+    unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+    int nodes[MAX_NUMA_NODES];
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] |=
+        1UL << (node % (8 * sizeof(unsigned long)));
+    if (syscall(__NR_mbind, p, size, MPOL_BIND, mask, MAX_NUMA_NODES + 1, 0) == 0)
+        return 1;
+    return get_numa_nodes(nodes) == 1;
+}
+
+/*
+ * Allocate a test buffer backed by the pages selected with --pages, or with
+ * malloc() by default, and bind it to a NUMA node unless node is - 1. The
+ * buffers are pre-faulted so that the first test doesn't pay for the page
+ * faults. The page size advice of madvise() and the node binding must be in
+ * place before the buffer is touched, so MAP_POPULATE, which faults the
+ * pages in during mmap(), is only used for hugetlb pages without binding.
+ * Returns NULL on failure.
+ */
+static uint8_t *alloc_buffer(size_t size, int node) {
+    size_t huge_page_size = get_huge_page_size();
+    uint8_t *p;
+    if (page_mode == PAGES_DEFAULT && node < 0)
+        return malloc(size);
+    if (page_mode == PAGES_HUGETLB) {
+        size = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+            (node < 0 ? MAP_POPULATE : 0), - 1, 0);
+        if (p == MAP_FAILED)
+            return NULL;
+        if (node < 0)
+            return p;
+    }
+    else if (page_mode == PAGES_THP) {
+        /* Map a huge page more and trim the mapping to huge page alignment. */
+        size = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+        uint8_t *map = mmap(NULL, size + huge_page_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, - 1, 0);
+        if (map == MAP_FAILED)
+            return NULL;
+        p = (uint8_t *)(((uintptr_t)map + huge_page_size - 1) &
+            ~(uintptr_t)(huge_page_size - 1));
+        if (p > map)
+            munmap(map, p - map);
+        munmap(p + size, map + huge_page_size - p);
+        if (madvise(p, size, MADV_HUGEPAGE) < 0) {
+            munmap(p, size);
+            return NULL;
+        }
+    }
+    else {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, - 1, 0);
+        if (p == MAP_FAILED)
+            return NULL;
+        /* Transparent huge pages may be enabled system-wide. */
+        if (page_mode == PAGES_4K)
+            madvise(p, size, MADV_NOHUGEPAGE);
+    }
+    if (node >= 0 && !bind_to_node(p, size, node)) {
+        munmap(p, size);
+        return NULL;
+    }
+    for (size_t i = 0; i < size; i += PAGE_SZ)
+        p[i] = 0;
+    return p;
+}
+
+static void set_thread_buffers(int thread_index) {
+    uint8_t *buffer = buffer_alloc + (size_t)thread_index * BUFFER_SIZE;
+    buffer_page = buffer + ((4096 - ((uintptr_t)buffer & 4095)) & 4095);
+    buffer_chunk = buffer_page + 17 * 32;
+}
+
+/*
+ * The threads wait at the start gate after their warm-up until all of them
+ * have been created and are ready, so that they start measuring at the
+ * same time. Unlike a barrier, the gate can also be opened to abort when
+ * a thread fails to start.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int nu_ready;
+    int open;
+    int abort;
+} start_gate_t;
+
+typedef struct {
+    int thread_index;
+    int cpu;
+    void (*test_func)(int);
+    int bytes;
+    int nu_iterations;
+    start_gate_t *gate;
+    long long calls;
+    double duration;
+    double bandwidth;
+} thread_data_t;
+
+static void *test_thread(void *arg) {
+    thread_data_t *data = arg;
+    if (data->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(data->cpu, &set);
+        /* The thread is reported as not pinned if this fails. */
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            data->cpu = - 1;
+    }
+    set_thread_buffers(data->thread_index);
+    /* Warm-up. */
+    for (int i = 0; i < data->nu_iterations; i++)
+        data->test_func(i);
+    /* Start the measurement in all threads at the same time. */
+    start_gate_t *gate = data->gate;
+    pthread_mutex_lock(&gate->mutex);
+    gate->nu_ready++;
+    pthread_cond_broadcast(&gate->cond);
+    while (!gate->open)
+        pthread_cond_wait(&gate->cond, &gate->mutex);
+    int aborted = gate->abort;
+    pthread_mutex_unlock(&gate->mutex);
+    if (aborted)
+        return NULL;
+    data->bandwidth = measure_bandwidth(data->test_func, data->bytes,
+        data->nu_iterations, &data->calls, &data->duration);
+    return NULL;
+}
+
+static char memcpy_variant_to_char(int i);
+
+/* The result of a single run of a test, as reported by report_result(). */
+typedef struct {
+    int test_index;
+    const char *test_name;
+    int bytes;
+    int repeat;
+    long long calls;
+    double duration;
+    double bandwidth;
+    /* Per-thread results in multi-threaded mode. */
+    int cpu[MAX_THREADS];
+    double thread_bandwidth[MAX_THREADS];
+    /* Latency histogram in latency mode, otherwise NULL. */
+    histogram_t *latency;
+    /* Time of a pass over the victim buffer in victim mode. */
+    double victim_alone;
+    double victim_after;
+    /* Hardware event counts in counters mode, - 1 when unavailable. */
+    double count[NU_COUNTERS];
+    /* The harness time per call subtracted in stream mode, in ns. */
+    double harness_ns;
+    /* In cold and l2 cache mode, the bandwidth with the caches evicted. */
+    double cold_bandwidth;
+    double evict_us;
+} result_t;
+
+static result_t result;
+
+static void print_json_string(const char *str) {
+    putchar('"');
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            printf("\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            printf("\\u%04X", *str);
+        else
+            putchar(*str);
+    }
+    putchar('"');
+}
+
+static void print_csv_string(const char *str) {
+    putchar('"');
+    for (; *str; str++) {
+        if (*str == '"')
+            putchar('"');
+        putchar(*str);
+    }
+    putchar('"');
+}
+
+/*
+ * Read a field such as "model name" from /proc/cpuinfo. Returns 0 if the
+ * field is not present.
+ */
+static int get_cpuinfo_field(const char *field, char *value, int size) {
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    if (f == NULL)
+        return 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *colon = strchr(line, ':');
+        if (colon == NULL || strncmp(line, field, strlen(field)) != 0)
+            continue;
+        char *p = line + strlen(field);
+        while (p < colon && isspace((unsigned char)*p))
+            p++;
+        if (p != colon)
+            continue;
+        p = colon + 1;
+        while (isspace((unsigned char)*p))
+            p++;
+        p[strcspn(p, "\n")] = '\0';
+        snprintf(value, size, "%s", p);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+    return 0;
+}
+
+#ifdef CONFIG_THUMB2_KERNEL
+#define THUMB2_ENABLED 1
+#else
+#define THUMB2_ENABLED 0
+#endif
+
+/*
+ * Print the header of the machine-readable output formats with the
+ * compile-time configuration and the CPU model.
+ */
+static void begin_output() {
+    char cpu_model[256] = "unknown";
+    char hardware[256] = "unknown";
+    if (!get_cpuinfo_field("model name", cpu_model, sizeof(cpu_model)))
+        get_cpuinfo_field("Processor", cpu_model, sizeof(cpu_model));
+    get_cpuinfo_field("Hardware", hardware, sizeof(hardware));
+    if (output_format == FORMAT_JSON) {
+        printf("{\n  \"config\": {\n");
+#ifdef HOST
+        printf("    \"platform\": \"host\",\n");
+#else
+        printf("    \"platform\": \"armv%d\",\n", __LINUX_ARM_ARCH__);
+#endif
+        printf("    \"l1_cache_bytes\": %d,\n", L1_CACHE_BYTES);
+        printf("    \"prefetch_distance\": %d,\n", PREFETCH_DISTANCE);
+        printf("    \"write_align_bytes\": %d,\n", WRITE_ALIGN_BYTES);
+        printf("    \"thumb2\": %s,\n", THUMB2_ENABLED ? "true" : "false");
+        printf("    \"test_duration\": %.2lf,\n", test_duration);
+        printf("    \"threads\": %d,\n", nu_threads);
+        printf("    \"pages\": \"%s\",\n", page_mode_name[page_mode]);
+        printf("    \"cache\": \"%s\",\n", cache_mode_name[cache_mode]);
+        printf("    \"cpu_model\": ");
+        print_json_string(cpu_model);
+        printf(",\n    \"hardware\": ");
+        print_json_string(hardware);
+        printf("\n  },\n  \"results\": [");
+    }
+    else if (output_format == FORMAT_CSV) {
+#ifdef HOST
+        printf("# platform=host\n");
+#else
+        printf("# platform=armv%d\n", __LINUX_ARM_ARCH__);
+#endif
+        printf("# l1_cache_bytes=%d\n", L1_CACHE_BYTES);
+        printf("# prefetch_distance=%d\n", PREFETCH_DISTANCE);
+        printf("# write_align_bytes=%d\n", WRITE_ALIGN_BYTES);
+        printf("# thumb2=%d\n", THUMB2_ENABLED);
+        printf("# test_duration=%.2lf\n", test_duration);
+        printf("# threads=%d\n", nu_threads);
+        printf("# pages=%s\n", page_mode_name[page_mode]);
+        printf("# cache=%s\n", cache_mode_name[cache_mode]);
+        printf("# cpu_model=%s\n", cpu_model);
+        printf("# hardware=%s\n", hardware);
+        printf("test,test_name,variant,variant_name,bytes,iterations,repeat,"
+            "duration,bandwidth");
+        if (stream_mode)
+            printf(",harness_ns_per_call");
+        if (cache_mode >= CACHE_COLD)
+            printf(",%s_bandwidth,eviction_us", cache_mode_name[cache_mode]);
+        if (latency_mode)
+            printf(",latency_p50,latency_p90,latency_p99,latency_p99_9,latency_max");
+        if (victim_kb > 0)
+            printf(",victim_alone_ns,victim_after_ns");
+        if (counters_mode)
+            for (int i = 0; i < NU_COUNTERS; i++)
+                printf(",%s_per_byte,%s_per_call", counter[i].key, counter[i].key);
+        printf("\n");
+    }
+}
+
+static void end_output() {
+    if (output_format == FORMAT_JSON)
+        printf("\n  ]\n}\n");
+}
+
+/*
+ * Print the hardware event counts of a result per byte or per call in text
+ * output.
+ */
+static void report_counters(const result_t *r, const char *label,
+double divisor, const char *format) {
+    printf("    %s:", label);
+    for (int i = 0; i < NU_COUNTERS; i++) {
+        printf("%s %s ", i > 0 ? "," : "", counter[i].name);
+        if (r->count[i] < 0)
+            printf("n/a");
+        else
+            printf(format, r->count[i] / divisor);
+    }
+    printf("\n");
+}
+
+static void report_result(const result_t *r) {
+    double per_call = (double)r->calls;
+    double per_byte = (double)r->calls * r->bytes;
+    double p50 = 0, p90 = 0, p99 = 0, p99_9 = 0, max = 0;
+    if (r->latency != NULL) {
+        p50 = histogram_percentile(r->latency, 50.0) / LATENCY_BATCH_SIZE;
+        p90 = histogram_percentile(r->latency, 90.0) / LATENCY_BATCH_SIZE;
+        p99 = histogram_percentile(r->latency, 99.0) / LATENCY_BATCH_SIZE;
+        p99_9 = histogram_percentile(r->latency, 99.9) / LATENCY_BATCH_SIZE;
+        max = (double)r->latency->max / LATENCY_BATCH_SIZE;
+    }
+    if (output_format == FORMAT_JSON) {
+        printf("%s\n    { \"test\": %d, \"test_name\": ",
+            nu_results_output > 0 ? "," : "", r->test_index);
+        print_json_string(r->test_name);
+        printf(", \"variant\": \"%c\", \"variant_name\": ",
+            memcpy_variant_to_char(current_variant));
+        print_json_string(current_variant_name);
+        printf(", \"bytes\": %d, \"iterations\": %lld, \"repeat\": %d, "
+            "\"duration\": %.6lf, \"bandwidth\": %.2lf",
+            r->bytes, r->calls, r->repeat, r->duration, r->bandwidth);
+        if (trace_file != NULL)
+            printf(", \"calls_per_second\": %.0lf", r->calls / r->duration);
+        if (stream_mode)
+            printf(", \"harness_ns_per_call\": %.3lf", r->harness_ns);
+        if (cache_mode >= CACHE_COLD)
+            printf(", \"%s_bandwidth\": %.2lf, \"eviction_us\": %.1lf",
+                cache_mode_name[cache_mode], r->cold_bandwidth, r->evict_us);
+        if (nu_threads > 1) {
+            printf(", \"thread_bandwidth\": [");
+            for (int t = 0; t < nu_threads; t++)
+                printf("%s%.2lf", t > 0 ? ", " : "", r->thread_bandwidth[t]);
+            printf("]");
+        }
+        if (r->latency != NULL)
+            printf(", \"latency_ns\": { \"p50\": %.1lf, \"p90\": %.1lf, "
+                "\"p99\": %.1lf, \"p99.9\": %.1lf, \"max\": %.1lf }",
+                p50, p90, p99, p99_9, max);
+        if (victim_kb > 0)
+            printf(", \"victim\": { \"kb\": %d, \"alone_ns\": %.1lf, "
+                "\"after_ns\": %.1lf }", victim_kb, r->victim_alone,
+                r->victim_after);
+        if (counters_mode) {
+            printf(", \"counters\": { ");
+            for (int i = 0; i < NU_COUNTERS; i++) {
+                printf("%s\"%s\": ", i > 0 ? ", " : "", counter[i].key);
+                if (r->count[i] < 0)
+                    printf("null");
+                else
+                    printf("{ \"per_byte\": %.6lf, \"per_call\": %.2lf }",
+                        r->count[i] / per_byte, r->count[i] / per_call);
+            }
+            printf(" }");
+        }
+        printf(" }");
+    }
+    else if (output_format == FORMAT_CSV) {
+        printf("%d,", r->test_index);
+        print_csv_string(r->test_name);
+        printf(",%c,", memcpy_variant_to_char(current_variant));
+        print_csv_string(current_variant_name);
+        printf(",%d,%lld,%d,%.6lf,%.2lf", r->bytes, r->calls, r->repeat,
+            r->duration, r->bandwidth);
+        if (stream_mode)
+            printf(",%.3lf", r->harness_ns);
+        if (cache_mode >= CACHE_COLD)
+            printf(",%.2lf,%.1lf", r->cold_bandwidth, r->evict_us);
+        if (r->latency != NULL)
+            printf(",%.1lf,%.1lf,%.1lf,%.1lf,%.1lf", p50, p90, p99, p99_9, max);
+        if (victim_kb > 0)
+            printf(",%.1lf,%.1lf", r->victim_alone, r->victim_after);
+        if (counters_mode)
+            for (int i = 0; i < NU_COUNTERS; i++) {
+                if (r->count[i] < 0)
+                    printf(",,");
+                else
+                    printf(",%.6lf,%.2lf", r->count[i] / per_byte,
+                        r->count[i] / per_call);
+            }
+        printf("\n");
+    }
+    else if (nu_threads > 1) {
+        printf("%s: %.2lf MB/s", r->test_name, r->bandwidth);
+        if (trace_file != NULL)
+            printf(", %.0lf calls/s", r->calls / r->duration);
+        printf(" (aggregate, %d threads)\n", nu_threads);
+        for (int t = 0; t < nu_threads; t++)
+            if (r->cpu[t] >= 0)
+                printf("    thread %d (CPU %d): %.2lf MB/s\n", t, r->cpu[t],
+                    r->thread_bandwidth[t]);
+            else
+                printf("    thread %d (not pinned): %.2lf MB/s\n", t,
+                    r->thread_bandwidth[t]);
+    }
+    else {
+        printf("%s: %.2lf MB/s", r->test_name, r->bandwidth);
+        if (trace_file != NULL)
+            printf(", %.0lf calls/s", r->calls / r->duration);
+        if (stream_mode)
+            printf(" (harness %.2lf ns/call subtracted)", r->harness_ns);
+        if (cache_mode >= CACHE_COLD)
+            printf(" warm, %.2lf MB/s %s (%.1lf us eviction pass excluded)",
+                r->cold_bandwidth, cache_mode_name[cache_mode], r->evict_us);
+        if (r->latency != NULL)
+            printf(", latency p50 %.1lf p90 %.1lf p99 %.1lf p99.9 %.1lf max %.1lf ns",
+                p50, p90, p99, p99_9, max);
+        if (victim_kb > 0)
+            printf(", victim pass %.0lf ns alone, %.0lf ns after each call (%+.1lf%%)",
+                r->victim_alone, r->victim_after,
+                (r->victim_after / r->victim_alone - 1.0) * 100.0);
+        printf("\n");
+        if (counters_mode) {
+            report_counters(r, "per byte", per_byte, "%.4lf");
+            report_counters(r, "per call", per_call, "%.1lf");
+        }
+    }
+    fflush(stdout);
+    nu_results_output++;
+}
+
+/*
+ * Run the test concurrently in nu_threads threads, each pinned to a CPU
+ * from the affinity mask of the process (round-robin when there are more
+ * threads than CPUs).
+ */
+static void do_test_threaded(void (*test_func)(int), int bytes,
+int nu_iterations) {
+    thread_data_t data[MAX_THREADS];
+    pthread_t thread[MAX_THREADS];
+    start_gate_t gate = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+        0, 0, 0 };
+    cpu_set_t set;
+    int cpus[CPU_SETSIZE];
+    int nu_cpus = 0;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        for (int i = 0; i < CPU_SETSIZE; i++)
+            if (CPU_ISSET(i, &set))
+                cpus[nu_cpus++] = i;
+    clear_data_cache();
+    for (int t = 0; t < nu_threads; t++) {
+        data[t].thread_index = t;
+        data[t].cpu = nu_cpus > 0 ? cpus[t % nu_cpus] : - 1;
+        data[t].test_func = test_func;
+        data[t].bytes = bytes;
+        data[t].nu_iterations = nu_iterations;
+        data[t].gate = &gate;
+        if (pthread_create(&thread[t], NULL, test_thread, &data[t]) != 0) {
+            /* Release the threads that did start, then give up. */
+            pthread_mutex_lock(&gate.mutex);
+            gate.open = 1;
+            gate.abort = 1;
+            pthread_cond_broadcast(&gate.cond);
+            pthread_mutex_unlock(&gate.mutex);
+            for (int i = 0; i < t; i++)
+                pthread_join(thread[i], NULL);
+            printf("Unable to create thread %d.\n", t);
+            exit(1);
+        }
+    }
+    pthread_mutex_lock(&gate.mutex);
+    while (gate.nu_ready < nu_threads)
+        pthread_cond_wait(&gate.cond, &gate.mutex);
+    gate.open = 1;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.mutex);
+    result.bandwidth = 0;
+    result.calls = 0;
+    result.duration = 0;
+    for (int t = 0; t < nu_threads; t++) {
+        pthread_join(thread[t], NULL);
+        result.bandwidth += data[t].bandwidth;
+        result.calls += data[t].calls;
+        if (data[t].duration > result.duration)
+            result.duration = data[t].duration;
+        result.cpu[t] = data[t].cpu;
+        result.thread_bandwidth[t] = data[t].bandwidth;
+    }
+}
+
+static void do_test(int test_index, const char *name, void (*test_func)(int),
+int bytes, int repeat_index) {
+    static histogram_t h;
+    int nu_iterations = get_nu_iterations(bytes);
+    /* In stream mode bytes is per call and each iteration is a pass. */
+    if (stream_mode) {
+        nu_iterations /= stream_nu_ops;
+        if (nu_iterations == 0)
+            nu_iterations = 1;
+    }
+    result.test_index = test_index;
+    result.test_name = name;
+    result.bytes = bytes;
+    result.repeat = repeat_index;
+    result.latency = NULL;
+    if (nu_threads > 1) {
+        do_test_threaded(test_func, bytes, nu_iterations);
+        report_result(&result);
+        return;
+    }
+    /*
+     * Replay a trace from its start in every run (new threads start there
+     * anyway), so that all variants and repeats measure the same calls.
+     */
+    trace_position = 0;
+    /* Warm-up. */
+    if (cache_mode == CACHE_DEFAULT)
+        clear_data_cache();
+    for (int i = 0; i < nu_iterations; i++)
+       test_func(i);
+    usleep(100000);
+    if (counters_mode)
+        start_counters();
+    result.bandwidth = measure_bandwidth(test_func, bytes, nu_iterations,
+        &result.calls, &result.duration);
+    if (counters_mode) {
+        stop_counters(result.count);
+        subtract_counter_baseline(nu_iterations, result.calls, result.count);
+    }
+    if (stream_mode) {
+        /* Report per call, with the time of the empty replay subtracted. */
+        double harness = (double)result.calls * stream_nu_ops *
+            stream_baseline_ns / 1000000000.0;
+        result.calls *= stream_nu_ops;
+        result.bandwidth *= stream_nu_ops;
+        result.harness_ns = stream_baseline_ns;
+        if (harness < result.duration)
+            result.bandwidth *= result.duration / (result.duration - harness);
+    }
+    if (latency_mode) {
+        measure_latency(test_func, nu_iterations, &h);
+        result.latency = &h;
+    }
+    if (victim_kb > 0)
+        measure_victim(test_func, &result.victim_alone, &result.victim_after);
+    if (cache_mode >= CACHE_COLD)
+        result.cold_bandwidth = measure_cold(test_func, bytes, &result.evict_us);
+    report_result(&result);
+}
+
+/*
+ * Statistics over the repeats of a test. Outliers are rejected using the
+ * modified z-score based on the median absolute deviation (MAD), and the
+ * 95% confidence interval of the median is estimated by bootstrapping.
+ */
+
+typedef struct {
+    int n;
+    int rejected;
+    double median;
+    double mean;
+    double stddev;
+    double ci_low;
+    double ci_high;
+} stats_t;
+
+/* Bandwidth samples of each variant for the current test. */
+static double samples[MAX_VARIANTS][MAX_SAMPLES];
+static int nu_samples[MAX_VARIANTS];
+
+/* Private random number generator so that rand() sequences are unaffected. */
+static uint32_t stats_random_state = 2463534242U;
+
+static uint32_t stats_random() {
+    stats_random_state ^= stats_random_state << 13;
+    stats_random_state ^= stats_random_state >> 17;
+    stats_random_state ^= stats_random_state << 5;
+    return stats_random_state;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? - 1 : (x > y ? 1 : 0);
+}
+
+static double median_of(double *x, int n) {
+    qsort(x, n, sizeof(double), compare_doubles);
+    if (n & 1)
+        return x[n / 2];
+    return (x[n / 2 - 1] + x[n / 2]) / 2;
+}
+
+/* Return the median of a bootstrap resample of x. */
+static double resample_median(const double *x, int n, double *tmp) {
+    for (int i = 0; i < n; i++)
+        tmp[i] = x[stats_random() % n];
+    return median_of(tmp, n);
+}
+
+/*
+ * Copy the samples that are not outliers (modified z-score > 3.5) to out
+ * and return their number.
+ */
+static int reject_outliers(const double *x, int n, double *out) {
+    double tmp[MAX_SAMPLES];
+    memcpy(tmp, x, n * sizeof(double));
+    double median = median_of(tmp, n);
+    for (int i = 0; i < n; i++)
+        tmp[i] = fabs(x[i] - median);
+    double mad = median_of(tmp, n);
+    int count = 0;
+    for (int i = 0; i < n; i++)
+        if (mad == 0 || 0.6745 * fabs(x[i] - median) / mad <= 3.5)
+            out[count++] = x[i];
+    return count;
+}
+
+static void calculate_stats(const double *x, int n, stats_t *st) {
+    double kept[MAX_SAMPLES], tmp[MAX_SAMPLES], medians[BOOTSTRAP_RESAMPLES];
+    st->n = reject_outliers(x, n, kept);
+    st->rejected = n - st->n;
+    double sum = 0;
+    for (int i = 0; i < st->n; i++)
+        sum += kept[i];
+    st->mean = sum / st->n;
+    double sum_sq = 0;
+    for (int i = 0; i < st->n; i++)
+        sum_sq += (kept[i] - st->mean) * (kept[i] - st->mean);
+    st->stddev = st->n > 1 ? sqrt(sum_sq / (st->n - 1)) : 0;
+    memcpy(tmp, kept, st->n * sizeof(double));
+    st->median = median_of(tmp, st->n);
+    for (int i = 0; i < BOOTSTRAP_RESAMPLES; i++)
+        medians[i] = resample_median(kept, st->n, tmp);
+    qsort(medians, BOOTSTRAP_RESAMPLES, sizeof(double), compare_doubles);
+    st->ci_low = medians[(int)(0.025 * BOOTSTRAP_RESAMPLES)];
+    st->ci_high = medians[(int)(0.975 * BOOTSTRAP_RESAMPLES) - 1];
+}
+
+static double relative_ci_width(const stats_t *st) {
+    return st->median > 0 ? (st->ci_high - st->ci_low) * 100.0 / st->median : 0;
+}
+
+static void report_stats(const char *name, const stats_t *st) {
+    if (output_format == FORMAT_JSON) {
+        printf(",\n    { \"summary\": true, \"test\": %d, \"test_name\": ",
+            result.test_index);
+        print_json_string(name);
+        printf(", \"variant\": \"%c\", \"samples\": %d, \"rejected\": %d, "
+            "\"median\": %.2lf, \"mean\": %.2lf, \"stddev\": %.2lf, "
+            "\"ci_low\": %.2lf, \"ci_high\": %.2lf }",
+            memcpy_variant_to_char(current_variant), st->n + st->rejected,
+            st->rejected, st->median, st->mean, st->stddev, st->ci_low,
+            st->ci_high);
+    }
+    else if (output_format == FORMAT_CSV)
+        printf("# summary,%d,%c,%d,%d,%.2lf,%.2lf,%.2lf,%.2lf,%.2lf\n",
+            result.test_index, memcpy_variant_to_char(current_variant),
+            st->n + st->rejected, st->rejected, st->median, st->mean,
+            st->stddev, st->ci_low, st->ci_high);
+    else
+        printf("%s: median %.2lf MB/s, mean %.2lf, stddev %.2lf, "
+            "95%% CI [%.2lf, %.2lf] (%d samples, %d outliers rejected)\n",
+            name, st->median, st->mean, st->stddev, st->ci_low, st->ci_high,
+            st->n + st->rejected, st->rejected);
+}
+
+/*
+ * Run a test repeatedly for the current variant. In adaptive mode
+ * (target_ci_width > 0), keep sampling after the first repeat runs until
+ * the 95% confidence interval of the median is narrower than
+ * target_ci_width percent of the median, or the time budget is exhausted.
+ */
+static void run_test_repeats(int test_index, const char *name,
+void (*test_func)(int), int bytes, int repeat) {
+    double start_time = get_time();
+    int n = 0;
+    stats_t st;
+    if (stream_mode) {
+        if (!prepare_stream(test_func)) {
+            printf("Unable to record the calls of test %d.\n", test_index);
+            exit(1);
+        }
+        test_func = stream_is_memset ? test_stream_memset : test_stream_memcpy;
+        bytes = (stream_bytes + stream_nu_ops / 2) / stream_nu_ops;
+    }
+    if (bytes <= 0) {
+        printf("Test %d doesn't copy any bytes.\n", test_index);
+        exit(1);
+    }
+    for (;;) {
+        do_test(test_index, name, test_func, bytes, n);
+        samples[current_variant][n++] = cache_mode >= CACHE_COLD ?
+            result.cold_bandwidth : result.bandwidth;
+        if (n == MAX_SAMPLES)
+            break;
+        if (n < repeat)
+            continue;
+        if (target_ci_width <= 0 || get_time() - start_time >= time_budget)
+            break;
+        if (n >= 3) {
+            calculate_stats(samples[current_variant], n, &st);
+            if (relative_ci_width(&st) < target_ci_width)
+                break;
+        }
+    }
+    nu_samples[current_variant] = n;
+    if (stats_mode && n >= 2) {
+        calculate_stats(samples[current_variant], n, &st);
+        report_stats(name, &st);
+    }
+}
+
+/*
+ * Compare the samples of variant b with those of the baseline variant a.
+ * The 95% confidence interval of the relative difference of the medians is
+ * estimated by bootstrapping; the difference is significant when the
+ * interval doesn't include zero.
+ */
+static void compare_variants(const char *name, int a, const char *name_a,
+int b, const char *name_b) {
+    double kept_a[MAX_SAMPLES], kept_b[MAX_SAMPLES], tmp[MAX_SAMPLES];
+    double diff[BOOTSTRAP_RESAMPLES];
+    int n_a = reject_outliers(samples[a], nu_samples[a], kept_a);
+    int n_b = reject_outliers(samples[b], nu_samples[b], kept_b);
+    memcpy(tmp, kept_a, n_a * sizeof(double));
+    double median_a = median_of(tmp, n_a);
+    memcpy(tmp, kept_b, n_b * sizeof(double));
+    double median_b = median_of(tmp, n_b);
+    for (int i = 0; i < BOOTSTRAP_RESAMPLES; i++) {
+        double m_a = resample_median(kept_a, n_a, tmp);
+        double m_b = resample_median(kept_b, n_b, tmp);
+        diff[i] = (m_b / m_a - 1.0) * 100.0;
+    }
+    qsort(diff, BOOTSTRAP_RESAMPLES, sizeof(double), compare_doubles);
+    double low = diff[(int)(0.025 * BOOTSTRAP_RESAMPLES)];
+    double high = diff[(int)(0.975 * BOOTSTRAP_RESAMPLES) - 1];
+    const char *verdict;
+    if (low > 0)
+        verdict = "significantly faster";
+    else if (high < 0)
+        verdict = "significantly slower";
+    else
+        verdict = "no significant difference";
+    double difference = (median_b / median_a - 1.0) * 100.0;
+    if (output_format == FORMAT_JSON) {
+        printf(",\n    { \"comparison\": true, \"test\": %d, \"test_name\": ",
+            result.test_index);
+        print_json_string(name);
+        printf(", \"baseline\": \"%c\", \"variant\": \"%c\", "
+            "\"difference_percent\": %.2lf, \"ci_low\": %.2lf, "
+            "\"ci_high\": %.2lf, \"verdict\": \"%s\" }",
+            memcpy_variant_to_char(a), memcpy_variant_to_char(b), difference,
+            low, high, verdict);
+    }
+    else if (output_format == FORMAT_CSV)
+        printf("# comparison,%d,%c,%c,%.2lf,%.2lf,%.2lf,%s\n", result.test_index,
+            memcpy_variant_to_char(a), memcpy_variant_to_char(b), difference,
+            low, high, verdict);
+    else
+        printf("%s: %s vs %s: %+.2lf%% (95%% CI [%+.2lf%%, %+.2lf%%]), %s\n",
+            name, name_b, name_a, difference, low, high, verdict);
+}
+
+/* Compare every selected variant with the first selected variant. */
+static void compare_selected_variants(const char *name, const int *mask,
+int nu_variants, const char **variant_name) {
+    int baseline = - 1;
+    if (!compare_mode)
+        return;
+    for (int j = 0; j < nu_variants; j++) {
+        if (!mask[j] || nu_samples[j] < 2)
+            continue;
+        if (baseline < 0)
+            baseline = j;
+        else
+            compare_variants(name, baseline, variant_name[baseline], j,
+                variant_name[j]);
+    }
+}
+
+static void fill_buffer(uint8_t *buffer) {
+    for (int i = 0; i < 1024 * 1024 * 16; i++) {
+        buffer[i] = i & 0xFF;
+    }
+}
+
+static int compare_buffers(uint8_t *buffer0, uint8_t *buffer1) {
+    int identical = 1;
+    int count = 0;
+    for (int i = 0; i < 1024 * 1024 * 16; i++) {
+        if (buffer0[i] != buffer1[i]) {
+            count++;
+	    if (count < 10) {
+                printf("Byte at offset %d (0x%08X) doesn't match.\n",
+                    i, i);
+                identical = 0;
+            }
+	}
+    }
+    if (count >= 10) {
+        printf("(%d more non-matching bytes present.)\n", count - 9);
+    }
+    return identical;
+}
+
+static void memcpy_emulate(uint8_t *dest, uint8_t *src, int size) {
+    for (int i = 0; i < size; i++)
+        dest[i] = src[i];
+}
+
+static void do_validation(int repeat) {
+    int passed = 1;
+    for (int i = 0; i < 10 * repeat; i++)  {
+        int size, source, dest;
+        if (memcpy_func == copy_page_wrapper ||
+        memcpy_func == copy_page_orig_wrapper) {
+            size = 4096;
+            source = 4096 * (rand() % (1024 * 1024 * 16 / 4096));
+            do {
+                dest = 4096 * (rand() % (1024 * 1024 * 16 / 4096));
+            } while (dest == source);
+        }
+        else {
+            size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
+            source = rand() % (1024 * 1024 * 16 + 1 - size);
+            int aligned = 0;
+            if ((rand() & 3) == 0) {
+		aligned = 1;
+                source &= ~3;
+                size = (size + 3) & (~3);
+            }
+            do {
+                dest = rand() % (1024 * 1024 * 16 + 1 - size);
+                if (aligned)
+                    dest &= ~3;
+            }
+            while (dest + size > source && dest < source + size);
+        }
+        printf("Testing (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+        fflush(stdout);
+        fill_buffer(buffer_compare);
+        memcpy_emulate(buffer_compare + dest, buffer_compare + source, size);
+        fill_buffer(buffer_alloc);
+        memcpy_func(buffer_alloc + dest, buffer_alloc + source, size);
+        if (!compare_buffers(buffer_alloc, buffer_compare)) {
+            printf("Validation failed (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+            passed = 0;
+        }
+    }
+    if (passed) {
+        printf("Passed.\n");
+    }
+}
+
+static void memset_emulate(uint8_t *dest, int c, int size) {
+    for (int i = 0; i < size; i++)
+        dest[i] = c;
+}
+
+static void do_validation_memset(int repeat) {
+    int passed = 1;
+    for (int i = 0; i < 10 * repeat; i++)  {
+        int size, dest, c;
+        size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
+        dest = rand() % (1024 * 1024 * 16 + 1 - size);
+        if (memset_func == memzero_orig_wrapper || memset_func == memzero_wrapper)
+            c = 0;
+        else
+            c = rand() & 0xFF;
+        printf("Testing (destination offset = 0x%08X, byte = %d, size = %d).\n",
+                dest, c, size);
+        fflush(stdout);
+        fill_buffer(buffer_compare);
+        memset_emulate(buffer_compare + dest, c, size);
+        fill_buffer(buffer_alloc);
+        memset_func(buffer_alloc + dest, c, size);
+        if (!compare_buffers(buffer_alloc, buffer_compare)) {
+            printf("Validation failed (destination offset = 0x%08X, size = %d).\n",
+                dest, size);
+            passed = 0;
+        }
+    }
+    if (passed) {
+        printf("Passed.\n");
+    }
+}
+
+static void memmove_emulate(uint8_t *dest, uint8_t *src, int size) {
+    if (dest < src)
+        for (int i = 0; i < size; i++)
+            dest[i] = src[i];
+    else
+        for (int i = size - 1; i >= 0; i--)
+            dest[i] = src[i];
+}
+
+/*
+ * Validate memmove with the destination moved up or down from the source
+ * by a small distance, by a random distance within the size, and (to check
+ * the memcpy path) by more than the size.
+ */
+static void do_validation_memmove(int repeat) {
+    int passed = 1;
+    for (int i = 0; i < 10 * repeat; i++)  {
+        int size, source, dest, distance;
+        size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
+        switch (rand() & 3) {
+        case 0 :
+            distance = 1 + rand() % 64;
+            break;
+        case 1 :
+            distance = - 1 - rand() % 64;
+            break;
+        case 2 :
+            distance = rand() % (2 * size + 1) - size;
+            break;
+        default :
+            distance = size + rand() % 64;
+            if (rand() & 1)
+                distance = - distance;
+            break;
+        }
+        source = size + 64 + rand() % (1024 * 1024 * 16 - 3 * size - 256);
+        if ((rand() & 3) == 0) {
+            source &= ~3;
+            distance &= ~3;
+            size = (size + 3) & (~3);
+        }
+        dest = source + distance;
+        printf("Testing (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+        fflush(stdout);
+        fill_buffer(buffer_compare);
+        memmove_emulate(buffer_compare + dest, buffer_compare + source, size);
+        fill_buffer(buffer_alloc);
+        memmove_func(buffer_alloc + dest, buffer_alloc + source, size);
+        if (!compare_buffers(buffer_alloc, buffer_compare)) {
+            printf("Validation failed (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+            passed = 0;
+        }
+    }
+    if (passed) {
+        printf("Passed.\n");
+    }
+}
+
+/*
+ * The 16-bit Internet checksum of a buffer added to sum, with the bytes in
+ * the lanes of big-endian 16-bit words swapped to little-endian, like the
+ * folded result of csum_partial on a little-endian CPU.
+ */
+static uint32_t csum_emulate(const uint8_t *buf, int size, uint32_t sum) {
+    uint64_t total = sum;
+    for (int i = 0; i < size; i++)
+        total += (uint32_t)buf[i] << ((i & 1) * 8);
+    while (total >> 16)
+        total = (total & 0xFFFF) + (total >> 16);
+    return total;
+}
+
+/* The CRC32C of a buffer, computed one bit at a time. */
+static uint32_t crc32c_emulate(const uint8_t *buf, int size, uint32_t crc) {
+    for (int i = 0; i < size; i++) {
+        crc ^= buf[i];
+        for (int j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ (0x82F63B78 & - (crc & 1));
+    }
+    return crc;
+}
+
+static uint32_t csum_fold(uint32_t sum) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return sum;
+}
+
+/*
+ * Validate the copy and checksum functions. Both the copied data and the
+ * folded checksum must match.
+ */
+static void do_validation_csum(int repeat) {
+    int passed = 1;
+    for (int i = 0; i < 10 * repeat; i++)  {
+        int size, source, dest;
+        uint32_t sum, expected, result;
+        size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
+        source = rand() % (1024 * 1024 * 16 + 1 - size);
+        do {
+            dest = rand() % (1024 * 1024 * 16 + 1 - size);
+        }
+        while (dest + size > source && dest < source + size);
+        sum = ((uint32_t)rand() << 16) ^ rand();
+        printf("Testing (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+        fflush(stdout);
+        fill_buffer(buffer_compare);
+        memcpy_emulate(buffer_compare + dest, buffer_compare + source, size);
+        expected = csum_emulate(buffer_compare + source, size, sum);
+        fill_buffer(buffer_alloc);
+        result = csum_fold(csum_copy_func(buffer_alloc + dest,
+            buffer_alloc + source, size, sum));
+        if (!compare_buffers(buffer_alloc, buffer_compare)) {
+            printf("Validation failed (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+            passed = 0;
+        }
+        if (result != expected) {
+            printf("Checksum mismatch (size = %d, checksum = 0x%04X, expected 0x%04X).\n",
+                size, result, expected);
+            passed = 0;
+        }
+    }
+    if (passed) {
+        printf("Passed.\n");
+    }
+}
+
+/*
+ * Validate the copy and CRC functions. Both the copied data and the CRC
+ * must match.
+ */
+static void do_validation_crc(int repeat) {
+    int passed = 1;
+    for (int i = 0; i < 10 * repeat; i++)  {
+        int size, source, dest;
+        uint32_t crc, expected, result;
+        size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
+        source = rand() % (1024 * 1024 * 16 + 1 - size);
+        do {
+            dest = rand() % (1024 * 1024 * 16 + 1 - size);
+        }
+        while (dest + size > source && dest < source + size);
+        crc = ((uint32_t)rand() << 16) ^ rand();
+        printf("Testing (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+        fflush(stdout);
+        fill_buffer(buffer_compare);
+        memcpy_emulate(buffer_compare + dest, buffer_compare + source, size);
+        expected = crc32c_emulate(buffer_compare + source, size, crc);
+        fill_buffer(buffer_alloc);
+        result = crc_copy_func(buffer_alloc + dest, buffer_alloc + source, size,
+            crc);
+        if (!compare_buffers(buffer_alloc, buffer_compare)) {
+            printf("Validation failed (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+            passed = 0;
+        }
+        if (result != expected) {
+            printf("CRC mismatch (size = %d, CRC = 0x%08X, expected 0x%08X).\n",
+                size, result, expected);
+            passed = 0;
+        }
+    }
+    if (passed) {
+        printf("Passed.\n");
+    }
+}
+
+/*
+ * Validate the fault handling of the user copy functions. The copy may
+ * report more bytes as not copied than lie beyond the guard page (data
+ * that was loaded but not yet stored when the fault hit), but never fewer,
+ * and the bytes reported as copied must match. Kernel buffer bytes beyond
+ * them are undefined after a fault, the rest of the buffer must be intact.
+ */
+static void do_validation_fault(int repeat) {
+    int passed = 1;
+    for (int i = 0; i < 10 * repeat; i++)  {
+        int size, offset, kernel;
+        uint8_t *user;
+        size_t not_copied, copied;
+        size = floor(pow(2.0, (double)rand() * 16.0 / RAND_MAX));
+        offset = rand() % (size + 1);
+        kernel = rand() % (1024 * 1024 * 16 + 1 - size);
+        user = fault_guard_page(rand() % FAULT_NU_GUARD_PAGES) - offset;
+        printf("Testing (kernel offset = 0x%08X, size = %d, fault offset = %d).\n",
+                kernel, size, offset);
+        fflush(stdout);
+        fill_buffer(buffer_compare);
+        fill_buffer(buffer_alloc);
+        for (int j = 0; j < offset; j++)
+            user[j] = (uint8_t)(j * 7 + i);
+        if (fault_to_user)
+            not_copied = copy_user_fault(user, buffer_alloc + kernel, size, user);
+        else
+            not_copied = copy_user_fault(buffer_alloc + kernel, user, size, user);
+        if (not_copied < size - offset || not_copied > size) {
+            printf("Wrong number of bytes not copied (size = %d, fault offset = %d, not copied = %d).\n",
+                size, offset, (int)not_copied);
+            passed = 0;
+            continue;
+        }
+        copied = size - not_copied;
+        if (fault_to_user) {
+            if (memcmp(user, buffer_alloc + kernel, copied) != 0 ||
+            !compare_buffers(buffer_alloc, buffer_compare)) {
+                printf("Validation failed (kernel offset = 0x%08X, size = %d, fault offset = %d).\n",
+                    kernel, size, offset);
+                passed = 0;
+            }
+            continue;
+        }
+        memcpy_emulate(buffer_compare + kernel, user, copied);
+        memcpy(buffer_compare + kernel + copied, buffer_alloc + kernel + copied,
+            not_copied);
+        if (!compare_buffers(buffer_alloc, buffer_compare)) {
+            printf("Validation failed (kernel offset = 0x%08X, size = %d, fault offset = %d).\n",
+                kernel, size, offset);
+            passed = 0;
+        }
+    }
+    if (passed) {
+        printf("Passed.\n");
+    }
+}
+
+/*
+ * Validate the remap mode. Half of the tests are page aligned with sizes
+ * from 4 KB to 4 MB, so that the remap front end moves the pages when the
+ * size is above the threshold. The destination must match, and after a
+ * move the source must read as its old contents or as zeroes.
+ */
+static void do_validation_remap(int repeat) {
+    int passed = 1;
+    int page_offset = buffer_page - buffer_alloc;
+    for (int i = 0; i < 10 * repeat; i++)  {
+        int size, source, dest;
+        if ((rand() & 1) || memcpy_func == copy_pages_wrapper) {
+            size = 4096 << (rand() % 11);
+            int nu_pages = (1024 * 1024 * 16 - page_offset - size) / 4096;
+            source = page_offset + 4096 * (rand() % (nu_pages + 1));
+            do {
+                dest = page_offset + 4096 * (rand() % (nu_pages + 1));
+            }
+            while (dest + size > source && dest < source + size);
+        }
+        else {
+            size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
+            source = rand() % (1024 * 1024 * 16 + 1 - size);
+            do {
+                dest = rand() % (1024 * 1024 * 16 + 1 - size);
+            }
+            while (dest + size > source && dest < source + size);
+        }
+        printf("Testing (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+        fflush(stdout);
+        fill_buffer(buffer_compare);
+        memcpy_emulate(buffer_compare + dest, buffer_compare + source, size);
+        fill_buffer(buffer_alloc);
+        memcpy_func(buffer_alloc + dest, buffer_alloc + source, size);
+        for (int j = source; j < source + size; j++)
+            if (buffer_alloc[j] == 0)
+                buffer_compare[j] = 0;
+        if (!compare_buffers(buffer_alloc, buffer_compare)) {
+            printf("Validation failed (source offset = 0x%08X, destination offset = 0x%08X, size = %d).\n",
+                source, dest, size);
+            passed = 0;
+        }
+    }
+    if (passed) {
+        printf("Passed.\n");
+    }
+}
+
+/*
+ * Validate the vec mode with batches of up to 16 descriptors. The
+ * destinations lie in the first 8 MB and the sources in the second, and
+ * the destinations of a batch may overlap, so the copies must be done in
+ * order.
+ */
+static void do_validation_vec(int repeat) {
+    int passed = 1;
+    struct copy_desc descs[16];
+    for (int i = 0; i < 10 * repeat; i++)  {
+        int nu_descs = rand() % 17;
+        int bytes = 0;
+        fill_buffer(buffer_compare);
+        for (int j = 0; j < nu_descs; j++) {
+            int size, source, dest;
+            size = floor(pow(2.0, (double)rand() * 12.0 / RAND_MAX));
+            source = 1024 * 1024 * 8 + rand() % (1024 * 1024 * 8 + 1 - size);
+            dest = rand() % (1024 * 1024 * 8 + 1 - size);
+            if (rand() & 1) {
+                size &= ~3;
+                source &= ~3;
+                dest &= ~3;
+            }
+            descs[j].dest = buffer_alloc + dest;
+            descs[j].src = buffer_alloc + source;
+            descs[j].n = size;
+            memcpy_emulate(buffer_compare + dest, buffer_compare + source, size);
+            bytes += size;
+        }
+        printf("Testing (descriptors = %d, bytes = %d).\n", nu_descs, bytes);
+        fflush(stdout);
+        fill_buffer(buffer_alloc);
+        vec_func(descs, nu_descs);
+        if (!compare_buffers(buffer_alloc, buffer_compare)) {
+            printf("Validation failed (descriptors = %d, bytes = %d).\n",
+                nu_descs, bytes);
+            passed = 0;
+        }
+    }
+    if (passed) {
+        printf("Passed.\n");
+    }
+}
+
+/*
+ * Differential fuzzing (--fuzz). Instead of refilling and comparing the
+ * whole 16 MB buffer for every case, each case only compares a window
+ * covering the destination range plus FUZZ_GUARD bytes on either side
+ * against the result of libc memcpy or memset on a reference copy, and
+ * then restores that window. This makes it cheap enough to try every
+ * size from 0 to FUZZ_MAX_EDGE_SIZE with every source and destination
+ * offset modulo FUZZ_OFFSETS, followed by random large cases.
+ */
+
+#define FUZZ_MAX_EDGE_SIZE 512
+#define FUZZ_OFFSETS 64
+#define FUZZ_GUARD 128
+#define FUZZ_REGION (1024 * 1024 * 4)
+#define FUZZ_MAX_REPORTED 10
+
+static uint8_t *fuzz_src, *fuzz_pristine, *fuzz_dest;
+static int fuzz_nu_failed;
+
+/*
+ * The source, the pristine destination contents and the destination are
+ * consecutive page aligned regions filled with independent random bytes,
+ * so that a byte copied from the wrong place or written where it should
+ * not be is almost always caught. buffer_compare holds the reference.
+ */
+static void init_fuzz(void) {
+    fuzz_src = buffer_page;
+    fuzz_pristine = buffer_page + FUZZ_REGION;
+    fuzz_dest = buffer_page + FUZZ_REGION * 2;
+    for (int i = 0; i < FUZZ_REGION; i++) {
+        fuzz_src[i] = rand();
+        fuzz_pristine[i] = rand();
+    }
+    memcpy(fuzz_dest, fuzz_pristine, FUZZ_REGION);
+    fuzz_nu_failed = 0;
+}
+
+/*
+ * Compare the window around the destination range of size bytes at dest
+ * with the reference and restore it. Returns the position of the first
+ * wrong byte relative to dest (negative or >= size for a guard byte), or
+ * FUZZ_GUARD + size if the window matches.
+ */
+static int fuzz_check_window(int dest, int size) {
+    int start = dest - FUZZ_GUARD;
+    int len = size + FUZZ_GUARD * 2;
+    int first = FUZZ_GUARD + size;
+    if (memcmp(fuzz_dest + start, buffer_compare + start, len) != 0)
+        for (first = - FUZZ_GUARD; first < size + FUZZ_GUARD; first++)
+            if (fuzz_dest[dest + first] != buffer_compare[dest + first])
+                break;
+    memcpy(fuzz_dest + start, fuzz_pristine + start, len);
+    return first;
+}
+
+static void fuzz_report(int source, int dest, int size, int first) {
+    if (first == FUZZ_GUARD + size)
+        return;
+    if (fuzz_nu_failed < FUZZ_MAX_REPORTED) {
+        const char *where = first < 0 ? "before the destination" :
+            first >= size ? "after the destination" : "in the destination";
+        if (source >= 0)
+            printf("Validation failed (source offset = 0x%08X, destination offset = 0x%08X, "
+                "size = %d): byte %d %s is wrong.\n", source, dest, size, first, where);
+        else
+            printf("Validation failed (destination offset = 0x%08X, size = %d): "
+                "byte %d %s is wrong.\n", dest, size, first, where);
+    }
+    fuzz_nu_failed++;
+}
+
+static void fuzz_memcpy_case(int source, int dest, int size) {
+    memcpy(buffer_compare + dest - FUZZ_GUARD, fuzz_pristine + dest - FUZZ_GUARD,
+        size + FUZZ_GUARD * 2);
+    memcpy(buffer_compare + dest, fuzz_src + source, size);
+    memcpy_func(fuzz_dest + dest, fuzz_src + source, size);
+    fuzz_report(source, dest, size, fuzz_check_window(dest, size));
+}
+
+static void fuzz_memset_case(int dest, int c, int size) {
+    memcpy(buffer_compare + dest - FUZZ_GUARD, fuzz_pristine + dest - FUZZ_GUARD,
+        size + FUZZ_GUARD * 2);
+    memset(buffer_compare + dest, c, size);
+    memset_func(fuzz_dest + dest, c, size);
+    fuzz_report(- 1, dest, size, fuzz_check_window(dest, size));
+}
+
+static int end_fuzz(void) {
+    if (fuzz_nu_failed > FUZZ_MAX_REPORTED)
+        printf("(%d more failing cases.)\n", fuzz_nu_failed - FUZZ_MAX_REPORTED);
+    if (fuzz_nu_failed == 0)
+        printf("Passed.\n");
+    return fuzz_nu_failed == 0;
+}
+
+/* Fuzz memcpy_func. Returns 1 if all cases passed. */
+static int do_fuzz(int repeat) {
+    init_fuzz();
+    if (memcpy_func == copy_page_wrapper ||
+    memcpy_func == copy_page_orig_wrapper) {
+        /* copy_page only copies whole pages, so only page aligned pages are tested. */
+        printf("Testing %d random pages.\n", 100 * repeat);
+        fflush(stdout);
+        for (int i = 0; i < 100 * repeat; i++)
+            fuzz_memcpy_case(4096 * (rand() % (FUZZ_REGION / 4096)),
+                4096 * (1 + rand() % (FUZZ_REGION / 4096 - 2)), 4096);
+        return end_fuzz();
+    }
+    printf("Testing %d edge cases (sizes 0 to %d, source and destination offsets 0 to %d).\n",
+        (FUZZ_MAX_EDGE_SIZE + 1) * FUZZ_OFFSETS * FUZZ_OFFSETS, FUZZ_MAX_EDGE_SIZE,
+        FUZZ_OFFSETS - 1);
+    fflush(stdout);
+    for (int size = 0; size <= FUZZ_MAX_EDGE_SIZE; size++)
+        for (int source = 0; source < FUZZ_OFFSETS; source++)
+            for (int dest = FUZZ_GUARD; dest < FUZZ_GUARD + FUZZ_OFFSETS; dest++)
+                fuzz_memcpy_case(source, dest, size);
+    printf("Testing %d random cases (sizes up to 1M).\n", 100 * repeat);
+    fflush(stdout);
+    for (int i = 0; i < 100 * repeat; i++)  {
+        int size, source, dest;
+        size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
+        source = rand() % (FUZZ_REGION + 1 - size);
+        dest = FUZZ_GUARD + rand() % (FUZZ_REGION - FUZZ_GUARD * 2 + 1 - size);
+        if ((rand() & 3) == 0) {
+            source &= ~3;
+            dest &= ~3;
+            size &= ~3;
+        }
+        fuzz_memcpy_case(source, dest, size);
+    }
+    return end_fuzz();
+}
+
+static int do_fuzz_memset(int repeat) {
+    int zero = memset_func == memzero_orig_wrapper || memset_func == memzero_wrapper;
+    init_fuzz();
+    printf("Testing %d edge cases (sizes 0 to %d, destination offsets 0 to %d).\n",
+        (FUZZ_MAX_EDGE_SIZE + 1) * FUZZ_OFFSETS, FUZZ_MAX_EDGE_SIZE, FUZZ_OFFSETS - 1);
+    fflush(stdout);
+    for (int size = 0; size <= FUZZ_MAX_EDGE_SIZE; size++)
+        for (int dest = FUZZ_GUARD; dest < FUZZ_GUARD + FUZZ_OFFSETS; dest++)
+            fuzz_memset_case(dest, zero ? 0 : rand() & 0xFF, size);
+    printf("Testing %d random cases (sizes up to 1M).\n", 100 * repeat);
+    fflush(stdout);
+    for (int i = 0; i < 100 * repeat; i++)  {
+        int size, dest;
+        size = floor(pow(2.0, (double)rand() * 20.0 / RAND_MAX));
+        dest = FUZZ_GUARD + rand() % (FUZZ_REGION - FUZZ_GUARD * 2 + 1 - size);
+        fuzz_memset_case(dest, zero ? 0 : rand() & 0xFF, size);
+    }
+    return end_fuzz();
+}
+
+#define NU_TESTS 50
+
+typedef struct {
+    const char *name;
+    void (*test_func)();
+    int bytes;
+} test_t;
+
+static test_t test[NU_TESTS] = {
+    { "Mixed powers of 2 from 4 to 4096 (power law), word aligned", test_mixed_powers_of_two_word_aligned, 32768 },
+    { "Mixed multiples of 4 from 4 to 1024 (power law), word aligned", test_mixed_power_law_word_aligned, 32768 },
+    { "Mixed from 1 to 1023 (power law), unaligned", test_mixed_power_law_unaligned, 32768 },
+    { "4 bytes word aligned", test_aligned_4, 4 },
+    { "8 bytes word aligned", test_aligned_8, 8 },
+    { "16 bytes word aligned", test_aligned_16, 16 },
+    { "28 bytes word aligned", test_aligned_28, 28 },
+    { "32 bytes word aligned", test_aligned_32, 32 },
+    { "64 bytes word aligned", test_aligned_64, 64 },
+    { "128 bytes word aligned", test_aligned_128, 128 },
+    { "256 bytes word aligned", test_aligned_256, 256 },
+    { "3 bytes randomly aligned", test_unaligned_random_3, 3 },
+    { "8 bytes randomly aligned", test_unaligned_random_8, 8 },
+    { "17 bytes randomly aligned", test_unaligned_random_17, 17 },
+    { "28 bytes randomly aligned", test_unaligned_random_28, 28 },
+    { "64 bytes randomly aligned", test_unaligned_random_64, 64 },
+    { "137 bytes randomly aligned", test_unaligned_random_137, 137 },
+    { "1024 bytes randomly aligned", test_unaligned_random_1024, 1024 },
+    { "32768 bytes randomly aligned", test_unaligned_random_32768, 32768 },
+    { "1M bytes randomly aligned", test_unaligned_random_1M, 1024 * 1024 },
+    { "64 bytes randomly aligned, source aligned with dest",
         test_source_dest_aligned_random_64, 64 },
     { "1024 bytes randomly aligned, source aligned with dest",
         test_source_dest_aligned_random_1024, 1024 },
@@ -862,6 +3944,306 @@ static test_t memset_test[NU_MEMSET_TESTS] = {
     { "1023 bytes randomly aligned", test_memset_unaligned_random_1023, 1023 },
 };
 
+#define NU_MEMMOVE_TESTS 14
+
+static test_t memmove_test[NU_MEMMOVE_TESTS] = {
+    { "Mixed from 1 to 1023 (power law), moved up or down by up to 64 bytes",
+        test_memmove_mixed_power_law_unaligned, 512 },
+    { "64 bytes word aligned, moved up 4 bytes", test_memmove_aligned_64_up, 64 },
+    { "64 bytes word aligned, moved down 4 bytes", test_memmove_aligned_64_down, 64 },
+    { "64 bytes randomly aligned, moved up 1 to 32 bytes",
+        test_memmove_unaligned_random_64_up, 64 },
+    { "64 bytes randomly aligned, moved down 1 to 32 bytes",
+        test_memmove_unaligned_random_64_down, 64 },
+    { "1024 bytes word aligned, moved up 4 bytes", test_memmove_aligned_1024_up, 1024 },
+    { "1024 bytes word aligned, moved down 4 bytes", test_memmove_aligned_1024_down, 1024 },
+    { "1024 bytes randomly aligned, moved up 1 to 32 bytes",
+        test_memmove_unaligned_random_1024_up, 1024 },
+    { "1024 bytes randomly aligned, moved down 1 to 32 bytes",
+        test_memmove_unaligned_random_1024_down, 1024 },
+    { "32768 bytes randomly aligned, moved up 1 to 32 bytes",
+        test_memmove_unaligned_random_32768_up, 32768 },
+    { "32768 bytes randomly aligned, moved down 1 to 32 bytes",
+        test_memmove_unaligned_random_32768_down, 32768 },
+    { "1M bytes page aligned, moved up 4096 bytes", test_memmove_page_aligned_1M_up,
+        1024 * 1024 },
+    { "1M bytes page aligned, moved down 4096 bytes", test_memmove_page_aligned_1M_down,
+        1024 * 1024 },
+    { "1024 bytes randomly aligned, not overlapping",
+        test_memmove_unaligned_random_1024_no_overlap, 1024 },
+};
+
+#define NU_CSUM_TESTS 8
+
+static test_t csum_test[NU_CSUM_TESTS] = {
+    { "Mixed from 1 to 1023 (power law), unaligned", test_csum_mixed_power_law_unaligned, 32768 },
+    { "64 bytes word aligned", test_csum_aligned_64, 64 },
+    { "1500 bytes word aligned", test_csum_aligned_1500, 1500 },
+    { "1500 bytes, word aligned destination, source at offset 2",
+        test_csum_source_offset_2_1500, 1500 },
+    { "1500 bytes randomly aligned", test_csum_unaligned_random_1500, 1500 },
+    { "4096 bytes page aligned", test_csum_page_aligned_4096, 4096 },
+    { "9000 bytes word aligned", test_csum_aligned_9000, 9000 },
+    { "65536 bytes word aligned", test_csum_aligned_65536, 65536 },
+};
+
+#define NU_CRC_TESTS 9
+
+static test_t crc_test[NU_CRC_TESTS] = {
+    { "64 bytes word aligned", test_crc_aligned_64, 64 },
+    { "256 bytes word aligned", test_crc_aligned_256, 256 },
+    { "1024 bytes word aligned", test_crc_aligned_1024, 1024 },
+    { "4096 bytes page aligned", test_crc_page_aligned_4096, 4096 },
+    { "4096 bytes randomly aligned", test_crc_unaligned_random_4096, 4096 },
+    { "16384 bytes word aligned", test_crc_aligned_16384, 16384 },
+    { "65536 bytes word aligned", test_crc_aligned_65536, 65536 },
+    { "256K bytes word aligned", test_crc_aligned_262144, 262144 },
+    { "1M bytes word aligned", test_crc_aligned_1M, 1024 * 1024 },
+};
+
+#define NU_FAULT_TESTS 6
+
+static test_t fault_test[NU_FAULT_TESTS] = {
+    { "256 bytes word aligned, no fault", test_fault_aligned_256_no_fault, 256 },
+    { "256 bytes word aligned, fault at a random offset", test_fault_aligned_256, 256 },
+    { "4096 bytes word aligned, no fault", test_fault_aligned_4096_no_fault, 4096 },
+    { "4096 bytes word aligned, fault at a random offset", test_fault_aligned_4096, 4096 },
+    { "4096 bytes randomly aligned, fault at a random offset", test_fault_unaligned_random_4096, 4096 },
+    { "65536 bytes word aligned, fault at a random offset", test_fault_aligned_65536, 65536 },
+};
+
+#define NU_REMAP_TESTS 7
+
+static test_t remap_test[NU_REMAP_TESTS] = {
+    { "4096 bytes page aligned, moved", test_remap_page_aligned_4096, 4096 },
+    { "16384 bytes page aligned, moved", test_remap_page_aligned_16384, 16384 },
+    { "65536 bytes page aligned, moved", test_remap_page_aligned_65536, 65536 },
+    { "256K bytes page aligned, moved", test_remap_page_aligned_256K, 256 * 1024 },
+    { "1M bytes page aligned, moved", test_remap_page_aligned_1M, 1024 * 1024 },
+    { "2M bytes page aligned, moved", test_remap_page_aligned_2M, 2 * 1024 * 1024 },
+    { "8M bytes page aligned, moved", test_remap_page_aligned_8M, 8 * 1024 * 1024 },
+};
+
+#define NU_VEC_TESTS 4
+
+static test_t vec_test[NU_VEC_TESTS] = {
+    { "Batches of 32, multiples of 4 from 4 to 1024 (power law), word aligned, sources within 4 KB",
+        test_vec_word_aligned_in_cache, 0 },
+    { "Batches of 32, multiples of 4 from 4 to 1024 (power law), word aligned, sources within 4 MB",
+        test_vec_word_aligned_scattered, 0 },
+    { "Batches of 32, multiples of 4 from 4 to 1024 (power law), unaligned, sources within 1 MB",
+        test_vec_unaligned_scattered, 0 },
+    { "Batches of 4, multiples of 4 from 4 to 1024 (power law), word aligned, sources within 4 KB",
+        test_vec_word_aligned_in_cache_batch_4, 0 },
+};
+
+/* The parameter grid of new_arm_tune.S for --tune. */
+
+#define TUNE_DECLARE(set, ls, pd, wa, aa) \
+    extern void *TUNE_FUNCTION_NAME(set, ls, pd, wa, aa)(void *dest, \
+        const void *src, size_t n);
+#define TUNE_DECLARE_SET(set, fp, ss, us, bs) TUNE_GRID(TUNE_DECLARE, set)
+TUNE_THRESHOLD_SETS(TUNE_DECLARE_SET)
+
+#define TUNE_SET_ENUM(set, fp, ss, us, bs) TUNE_SET_##set,
+enum { TUNE_THRESHOLD_SETS(TUNE_SET_ENUM) };
+
+typedef struct {
+    const char *name;
+    int fast_path_threshold;
+    int small_size_threshold;
+    int unaligned_small_size_threshold;
+    int both_unaligned_small_size_threshold;
+} tune_threshold_set_t;
+
+#define TUNE_SET_ENTRY(set, fp, ss, us, bs) { #set, fp, ss, us, bs },
+static const tune_threshold_set_t tune_threshold_set[NU_TUNE_THRESHOLD_SETS] = {
+    TUNE_THRESHOLD_SETS(TUNE_SET_ENTRY)
+};
+
+typedef struct {
+    int threshold_set;
+    int line_size;
+    int prefetch_distance;
+    int write_align;
+    int aligned_access;
+    memcpy_func_type func;
+    double score;
+} tune_variant_t;
+
+#define TUNE_ENTRY(set, ls, pd, wa, aa) \
+    { TUNE_SET_##set, ls, pd, wa, aa, TUNE_FUNCTION_NAME(set, ls, pd, wa, aa) },
+#define TUNE_ENTRY_SET(set, fp, ss, us, bs) TUNE_GRID(TUNE_ENTRY, set)
+static tune_variant_t tune_variant[] = {
+    TUNE_THRESHOLD_SETS(TUNE_ENTRY_SET)
+};
+
+#define NU_TUNE_VARIANTS (int)(sizeof(tune_variant) / sizeof(tune_variant[0]))
+
+/*
+ * Measure the bandwidth of memcpy_func for a test of the workload mix
+ * without reporting it. A test index of - 1 denotes the trace.
+ */
+static double tune_measure(int t) {
+    void (*test_func)(int);
+    int bytes;
+    long long calls;
+    double duration;
+    if (t < 0) {
+        test_func = test_trace_memcpy;
+        bytes = trace_memcpy_bytes;
+        trace_position = 0;
+    }
+    else {
+        test_func = test[t].test_func;
+        bytes = test[t].bytes;
+    }
+    int nu_iterations = get_nu_iterations(bytes);
+    /* Warm-up. */
+    for (int i = 0; i < nu_iterations; i++)
+        test_func(i);
+    return measure_bandwidth(test_func, bytes, nu_iterations, &calls,
+        &duration);
+}
+
+/* The score is the geometric mean of the bandwidth over the workload mix. */
+static double tune_score(memcpy_func_type func, const int *mix, int nu_mix) {
+    double log_sum = 0;
+    memcpy_func = func;
+    for (int i = 0; i < nu_mix; i++)
+        log_sum += log(tune_measure(mix[i]));
+    return exp(log_sum / nu_mix);
+}
+
+static void print_tune_variant(const tune_variant_t *v) {
+    printf("thresholds %s, line size %d, prefetch distance %d, write align %d%s",
+        tune_threshold_set[v->threshold_set].name, v->line_size,
+        v->prefetch_distance, v->write_align,
+        v->aligned_access ? ", aligned access" : "");
+}
+
+static int compare_tune_variants(const void *a, const void *b) {
+    double x = ((const tune_variant_t *)a)->score;
+    double y = ((const tune_variant_t *)b)->score;
+    return x > y ? - 1 : (x < y ? 1 : 0);
+}
+
+static int write_tune_header(const char *file_name, const tune_variant_t *v,
+const char *mix_description) {
+    const tune_threshold_set_t *ts = &tune_threshold_set[v->threshold_set];
+    char cpu_model[256] = "unknown";
+    char hardware[256] = "unknown";
+    FILE *f = fopen(file_name, "w");
+    if (f == NULL) {
+        printf("Unable to write %s.\n", file_name);
+        return 0;
+    }
+    if (!get_cpuinfo_field("model name", cpu_model, sizeof(cpu_model)))
+        get_cpuinfo_field("Processor", cpu_model, sizeof(cpu_model));
+    get_cpuinfo_field("Hardware", hardware, sizeof(hardware));
+    fprintf(f, "/*\n"
+        " * memcpy configuration selected by \"benchmark --tune\".\n"
+        " *\n"
+        " * CPU: %s, hardware: %s\n"
+        " * Workload: %s\n"
+        " * Score (geometric mean bandwidth): %.2lf MB/s\n"
+        " *\n"
+        " * Assemble new_arm.S with -DMEMCPY_REPLACEMENT_TUNED to build memcpy\n"
+        " * with this configuration.\n"
+        " */\n\n", cpu_model, hardware, mix_description, v->score);
+    fprintf(f, "#define MEMCPY_TUNED_LINE_SIZE %d\n", v->line_size);
+    fprintf(f, "#define MEMCPY_TUNED_PREFETCH_DISTANCE %d\n", v->prefetch_distance);
+    fprintf(f, "#define MEMCPY_TUNED_WRITE_ALIGN %d\n", v->write_align);
+    fprintf(f, "#define MEMCPY_TUNED_ALIGNED_ACCESS %d\n\n", v->aligned_access);
+    fprintf(f, "#define FAST_PATH_THRESHOLD %d\n", ts->fast_path_threshold);
+    fprintf(f, "#define SMALL_SIZE_THRESHOLD %d\n", ts->small_size_threshold);
+    fprintf(f, "#define UNALIGNED_SMALL_SIZE_THRESHOLD %d\n",
+        ts->unaligned_small_size_threshold);
+    fprintf(f, "#define BOTH_UNALIGNED_SMALL_SIZE_THRESHOLD %d\n",
+        ts->both_unaligned_small_size_threshold);
+    fclose(f);
+    return 1;
+}
+
+/*
+ * Benchmark every variant of the parameter grid once on the workload mix,
+ * then fuzz the variants in order of score until TUNE_FINALISTS of them
+ * have passed, measure those repeat times and write the one with the
+ * highest median score to a header file. Most grid points are parameter
+ * combinations that aren't built anywhere else, so a variant that fails
+ * validation is never a finalist.
+ */
+static int do_tune(const char *file_name, const int *mix, int nu_mix,
+const char *mix_description, int repeat) {
+    printf("Workload: %s\n", mix_description);
+    for (int i = 0; i < NU_TUNE_VARIANTS; i++) {
+        tune_variant[i].score = tune_score(tune_variant[i].func, mix, nu_mix);
+        printf("%3d/%d ", i + 1, NU_TUNE_VARIANTS);
+        print_tune_variant(&tune_variant[i]);
+        printf(": %.2lf MB/s\n", tune_variant[i].score);
+        fflush(stdout);
+    }
+    qsort(tune_variant, NU_TUNE_VARIANTS, sizeof(tune_variant_t),
+        compare_tune_variants);
+    printf("Validating:\n");
+    int nu_finalists = 0;
+    for (int i = 0; i < NU_TUNE_VARIANTS && nu_finalists < TUNE_FINALISTS; i++) {
+        print_tune_variant(&tune_variant[i]);
+        printf(":\n");
+        memcpy_func = tune_variant[i].func;
+        if (!do_fuzz(repeat))
+            continue;
+        /* Move it behind the finalists so far, which keeps the order. */
+        tune_variant_t v = tune_variant[i];
+        tune_variant[i] = tune_variant[nu_finalists];
+        tune_variant[nu_finalists++] = v;
+    }
+    if (nu_finalists == 0) {
+        printf("No variant passed validation.\n");
+        return 0;
+    }
+    printf("Finalists:\n");
+    for (int i = 0; i < nu_finalists; i++) {
+        double scores[MAX_SAMPLES];
+        for (int j = 0; j < repeat; j++)
+            scores[j] = tune_score(tune_variant[i].func, mix, nu_mix);
+        tune_variant[i].score = median_of(scores, repeat);
+        print_tune_variant(&tune_variant[i]);
+        printf(": %.2lf MB/s (median of %d)\n", tune_variant[i].score, repeat);
+        fflush(stdout);
+    }
+    qsort(tune_variant, nu_finalists, sizeof(tune_variant_t),
+        compare_tune_variants);
+    printf("Best: ");
+    print_tune_variant(&tune_variant[0]);
+    printf("\n");
+    if (!write_tune_header(file_name, &tune_variant[0], mix_description))
+        return 0;
+    printf("Configuration written to %s.\n", file_name);
+    return 1;
+}
+
+/*
+ * Parse a comma-separated list of memcpy test numbers. Returns the number of
+ * tests, or 0 if the list is invalid.
+ */
+static int parse_tune_mix(const char *str, int *mix) {
+    int n = 0;
+    while (*str != '\0') {
+        char *end;
+        long t = strtol(str, &end, 10);
+        if (end == str || t < 0 || t >= NU_TESTS || n == NU_TESTS)
+            return 0;
+        mix[n++] = t;
+        str = end;
+        if (*str == ',')
+            str++;
+        else if (*str != '\0')
+            return 0;
+    }
+    return n;
+}
+
 static void usage() {
             printf("Commands:\n"
                 "--list          List test numbers and memcpy variants.\n"
@@ -875,8 +4257,105 @@ static void usage() {
                 "--memcpy <list> Instead of testing all memcpy variants, test only the memcpy variants\n"
                 "                in <list>. <list> is a string of characters from a to h or higher, corresponding\n"
                 "                to each memcpy variant (for example, abcdef selects the first six variants).\n"
+                "--memset <list> Test memset instead of memcpy, with the memset variants in <list>.\n"
+                "--memmove <list> Test memmove with overlapping buffers instead of memcpy, with the memmove\n"
+                "                variants in <list>.\n"
+                "--csum <list>   Test copying with the Internet checksum (csum_partial_copy) instead of memcpy,\n"
+                "                with the variants in <list>.\n"
+                "--crc <list>    Test copying with CRC32C instead of memcpy, with the variants in <list>.\n"
+                "--fault <list>  Test copy_from_user and copy_to_user with the user buffer running into an\n"
+                "                inaccessible page, with the variants in <list>. The faults are handled through\n"
+                "                the exception table, and the bandwidth counts the bytes requested.\n"
+                "--remap <list>  Test moving page-aligned blocks with the remap front end, which moves the\n"
+                "                pages with mremap at or above the remap threshold, against copy_page and\n"
+                "                memcpy, with the variants in <list>.\n"
+                "--remap-threshold <n> Sets the size in bytes from which the remap front end moves pages.\n"
+                "                Default is 65536. Use 4096 to find the crossover with the remap tests.\n"
+                "--vec <list>    Test batched copies of descriptor lists (memcpy_vec) against one memcpy call\n"
+                "                per descriptor, with the variants in <list>. The bandwidth is per batch.\n"
                 "--validate      Validate for correctness instead of measuring performance. The --repeat option\n"
                 "                can be used to influence the number of validation tests performed (default 5).\n"
+                "--fuzz          Validate the --memcpy or --memset variants with a differential fuzzer: every size\n"
+                "                from 0 to 512 with every source and destination offset modulo 64, then 100 random\n"
+                "                cases per --repeat, each checked against libc including 128 guard bytes on\n"
+                "                either side of the destination. copy_page is tested with random whole pages.\n"
+                "--stats         After the repeats of each test, report the median, mean, standard deviation\n"
+                "                and bootstrap 95%% confidence interval of the median, with outliers rejected.\n"
+                "--ci <pct>      Adaptive mode: after the --repeat runs, keep repeating until the 95%% confidence\n"
+                "                interval is narrower than pct percent of the median or the time budget is\n"
+                "                exhausted. Implies --stats.\n"
+                "--budget <n>    Time budget in seconds per test and variant in adaptive mode. Default is 60.\n"
+                "--compare       Compare every selected variant with the first one and report whether the\n"
+                "                difference of the medians is statistically significant. Implies --stats.\n"
+                "--format <f>    Output format for results: text (default), json or csv. The json and csv\n"
+                "                formats include a header with the configuration and the CPU model.\n"
+                "--pages <p>     Back the test buffers with 4k pages, thp (transparent huge pages) or\n"
+                "                hugetlb pages (MAP_HUGETLB, see /proc/sys/vm/nr_hugepages), pre-faulted.\n"
+                "                The default is to allocate them with malloc.\n"
+                "--precompute    Record the calls of each memcpy or memset test once into arrays of\n"
+                "                pointers and sizes, replay them in the timed loop, and subtract the time\n"
+                "                of a calibrated replay with an empty function, so that the bandwidth of\n"
+                "                small copies reflects the function and not the harness.\n"
+                "--cache <mode>  warm: don't clear the data cache before the warm-up of each test. cold:\n"
+                "                also measure with the caches evicted before every batch of calls, by a\n"
+                "                pass over a buffer twice the size of the last level cache (which also\n"
+                "                evicts the TLB) and over a block of code twice the size of the L1\n"
+                "                instruction cache. l2: like cold, evicting only the L1 data cache. The\n"
+                "                eviction passes are timed separately and excluded; the cold or l2\n"
+                "                bandwidth is reported next to the warm one and used for --stats.\n"
+                "--cache-batch <n> The number of calls per batch with --cache cold or l2. Default is 1.\n"
+                "--latency       Also measure the per-call latency in batches of 8 calls and report the\n"
+                "                p50/p90/p99/p99.9 and maximum latency (in ns) next to the bandwidth.\n"
+                "--victim <kb>   Also measure the collateral damage of each test on the cache: the time\n"
+                "                of a pass over a cache-resident victim buffer of kb KB, on its own and\n"
+                "                after each call.\n"
+                "--counters      Also count hardware events with perf_event_open (cycles, instructions,\n"
+                "                L1D and LLC misses, branch misses and stalled cycles) in user space during\n"
+                "                each test, reported per byte and per call, with the events of the timing\n"
+                "                loop itself subtracted. Events that the CPU or kernel doesn't support are\n"
+                "                reported as unavailable.\n"
+                "--threads <n>   Run each test concurrently in n threads, each pinned to a CPU and using its\n"
+                "                own buffer. Reports the aggregate and per-thread bandwidth.\n"
+                "--cpus <list>   Run only on the CPUs in <list> (for example 0-3,6), which also selects the\n"
+                "                CPUs that --threads pins its threads to.\n"
+                "--numa-matrix   Instead of the tests, copy 4 MB blocks with the memcpy variants from a\n"
+                "                source buffer bound to each NUMA node to a destination buffer bound to each\n"
+                "                node, and print a table of the bandwidth per pair of nodes.\n"
+                "--src-node <n>  Like --numa-matrix, with the source buffer bound to node n only.\n"
+                "--dst-node <n>  Like --numa-matrix, with the destination buffer bound to node n only.\n"
+                "--sweep         Instead of the tests, step the working set geometrically from 64 bytes to\n"
+                "                64 MB with the memcpy (with --memcpy) or memset (with --memset) variants and\n"
+                "                print the bandwidth against the working set with the cache boundaries\n"
+                "                marked. For memcpy, half of the working set is the source and half the\n"
+                "                destination. Default duration is 0.1 seconds.\n"
+                "--sweep-steps <n> Steps per doubling of the working set with --sweep, 1 to 8. Default is 2.\n"
+                "--src-align <n> With --sweep, the offset of the source from a page boundary, 0 to 4095.\n"
+                "--dst-align <n> With --sweep, the offset of the destination from a page boundary.\n"
+                "--stride <n>    With --sweep, walk the working set in calls of n bytes each instead of one\n"
+                "                call for the whole working set.\n"
+                "--workload <spec> Instead of the tests, run the memcpy (with --memcpy) or memset (with\n"
+                "                --memset) variants on the calls generated from <spec>, comma-separated\n"
+                "                key=value pairs. Can be given more than once. The keys are:\n"
+                "                size=<n>, <min>-<max> (uniform), <min>-<max>:pow2 or <min>-<max>:powerlaw;\n"
+                "                mult=<n> rounds the sizes down to a multiple of n;\n"
+                "                src=, dst= and align= (both) set the alignment class: byte, word, chunk\n"
+                "                (32), line (64), page or a power of two, optionally +<offset>;\n"
+                "                region=<n> is the size of the source and destination regions (K and M\n"
+                "                suffixes allowed); pattern=random, sequential or fixed; count=<n> calls;\n"
+                "                seed=<n>. For example size=4-1024:powerlaw,mult=4,align=word,region=4M.\n"
+                "                Defaults are align=byte, region=64K, pattern=random, count=1024 and seed=0.\n"
+                "                The bandwidth is measured over whole passes over the calls.\n"
+                "--workload-file <file> Like --workload, with one spec per line of <file>.\n"
+                "--tune <file>   Benchmark the grid of new_arm.S memcpy_variant parameters and threshold\n"
+                "                sizes on a workload mix and write the best configuration to a header file\n"
+                "                for building new_arm.S with -DMEMCPY_REPLACEMENT_TUNED. The best variants\n"
+                "                are validated as with --fuzz, and those that pass are measured again\n"
+                "                --repeat times. Default duration is 0.1 seconds.\n"
+                "--mix <list>    Comma-separated memcpy test numbers of the workload mix for --tune. Default\n"
+                "                is " DEFAULT_TUNE_MIX ". With --trace, the trace is used instead.\n"
+                "--trace <file>  Instead of the tests, replay the memcpy (with --memcpy) or memset (with\n"
+                "                --memset) calls of a trace captured with trace_shim.so and report MB/s and\n"
+                "                calls per second.\n"
                 );
 }
 
@@ -894,6 +4373,350 @@ static char memcpy_variant_to_char(int i) {
     return 'A' + i - 26;
 }
 
+#ifndef HWCAP_ARM_NEON
+#define HWCAP_ARM_NEON 4096
+#endif
+#ifndef HWCAP2_ARM_CRC32
+#define HWCAP2_ARM_CRC32 16
+#endif
+
+/*
+ * The NEON and CRC32 instruction variants are assembled in every ARM build,
+ * but only run on CPUs that support them. Deselect them on other CPUs.
+ */
+static void deselect_unsupported_variants(int *mask, int nu_variants,
+const char **variant_name, const int *variant_feature) {
+#ifndef HOST
+    static const char *feature_name[] = { NULL, "NEON", "the CRC32 instructions" };
+    int supported[] = {
+        1,
+        (getauxval(AT_HWCAP) & HWCAP_ARM_NEON) != 0,
+        (getauxval(AT_HWCAP2) & HWCAP2_ARM_CRC32) != 0
+    };
+    for (int j = 0; j < nu_variants; j++)
+        if (mask[j] && !supported[variant_feature[j]]) {
+            if (output_format == FORMAT_TEXT)
+                printf("Skipping %s, the CPU doesn't support %s.\n",
+                    variant_name[j], feature_name[variant_feature[j]]);
+            mask[j] = 0;
+        }
+#endif
+}
+
+static void select_variant(int i, const char *name) {
+    current_variant = i;
+    current_variant_name = name;
+    if (output_format == FORMAT_TEXT)
+        printf("%s:\n", name);
+}
+
+/*
+ * The copy test of the NUMA placement mode. Copy 4 MB blocks, page aligned,
+ * from the source buffer to the destination buffer, cycling through four
+ * blocks in each so that the copies go to memory.
+ */
+static void test_numa_copy(int i) {
+    memcpy_func(numa_dest + (i & 3) * NUMA_BLOCK_SIZE,
+        numa_source + ((i >> 2) & 3) * NUMA_BLOCK_SIZE, NUMA_BLOCK_SIZE);
+}
+
+/*
+ * Measure the bandwidth of the selected memcpy variants with the source on
+ * each of the source nodes and the destination on each of the destination
+ * nodes, and print a table of the median bandwidths per variant.
+ */
+static int do_numa_matrix(const int *src_nodes, int nu_src_nodes,
+const int *dst_nodes, int nu_dst_nodes, int repeat) {
+    /* Each buffer holds a source area followed by a destination area. */
+    uint8_t *node_buffer[MAX_NUMA_NODES];
+    static double bandwidth[MAX_NUMA_NODES][MAX_NUMA_NODES];
+    double tmp[MAX_SAMPLES];
+    char name[64];
+    for (int i = 0; i < MAX_NUMA_NODES; i++)
+        node_buffer[i] = NULL;
+    for (int i = 0; i < nu_src_nodes + nu_dst_nodes; i++) {
+        int node = i < nu_src_nodes ? src_nodes[i] : dst_nodes[i - nu_src_nodes];
+        if (node_buffer[node] != NULL)
+            continue;
+        node_buffer[node] = alloc_buffer(8 * NUMA_BLOCK_SIZE, node);
+        if (node_buffer[node] == NULL) {
+            printf("Unable to allocate buffer on node %d.\n", node);
+            return 0;
+        }
+    }
+    begin_output();
+    for (int j = 0; j < NU_MEMCPY_VARIANTS; j++) {
+        if (!memcpy_mask[j])
+            continue;
+        select_variant(j, memcpy_variant_name[j]);
+        memcpy_func = memcpy_variant[j];
+        for (int s = 0; s < nu_src_nodes; s++)
+            for (int d = 0; d < nu_dst_nodes; d++) {
+                numa_source = node_buffer[src_nodes[s]];
+                numa_dest = node_buffer[dst_nodes[d]] + 4 * NUMA_BLOCK_SIZE;
+                snprintf(name, sizeof(name),
+                    "4M bytes page aligned, node %d to node %d", src_nodes[s],
+                    dst_nodes[d]);
+                run_test_repeats(- 1, name, test_numa_copy, NUMA_BLOCK_SIZE,
+                    repeat);
+                memcpy(tmp, samples[j], sizeof(double) * nu_samples[j]);
+                bandwidth[s][d] = median_of(tmp, nu_samples[j]);
+            }
+        if (output_format != FORMAT_TEXT)
+            continue;
+        printf("Median bandwidth in MB/s, source node (rows) to destination node (columns):\n");
+        printf("        ");
+        for (int d = 0; d < nu_dst_nodes; d++) {
+            snprintf(name, sizeof(name), "node %d", dst_nodes[d]);
+            printf(" %9s", name);
+        }
+        printf("\n");
+        for (int s = 0; s < nu_src_nodes; s++) {
+            printf("node %-3d", src_nodes[s]);
+            for (int d = 0; d < nu_dst_nodes; d++)
+                printf(" %9.2lf", bandwidth[s][d]);
+            printf("\n");
+        }
+    }
+    end_output();
+    return 1;
+}
+
+/*
+ * The copy and set tests of the sweep mode. Each call moves on by
+ * sweep_block bytes, wrapping around at the end of the region.
+ */
+static void test_sweep_memcpy(int i) {
+    memcpy_func(sweep_dest + sweep_offset, sweep_source + sweep_offset,
+        sweep_block);
+    sweep_offset += sweep_block;
+    if (sweep_offset + sweep_block > sweep_region)
+        sweep_offset = 0;
+}
+
+static void test_sweep_memset(int i) {
+    memset_func(sweep_dest + sweep_offset, 0, sweep_block);
+    sweep_offset += sweep_block;
+    if (sweep_offset + sweep_block > sweep_region)
+        sweep_offset = 0;
+}
+
+/* Print the data and unified cache sizes that the kernel reports. */
+static void print_cache_sizes() {
+    int level, size, found = 0;
+    char type[32];
+    for (int i = 0; read_cache_info(i, &level, type, sizeof(type), &size); i++) {
+        if (strcmp(type, "Instruction") == 0)
+            continue;
+        printf("%s L%d %s %dK", found ? "," : "Cache sizes reported by the kernel:",
+            level, type, size / 1024);
+        found = 1;
+    }
+    if (found)
+        printf(".\n");
+}
+
+/*
+ * Find the cache boundaries of a bandwidth curve. The curve is smoothed
+ * with the median of each point and its neighbours first. A boundary is
+ * the largest working set before the bandwidth falls below SWEEP_CLIFF
+ * times the best bandwidth since the previous boundary, and stays below
+ * it at the next point too. Returns the number of boundaries, which are
+ * stored as indices into the curve.
+ */
+static int find_sweep_boundaries(const double *bandwidth, int n,
+int *boundary) {
+    double smooth[SWEEP_MAX_POINTS], tmp[3];
+    int nu_boundaries = 0;
+    for (int k = 0; k < n; k++) {
+        if (k == 0 || k == n - 1) {
+            smooth[k] = bandwidth[k];
+            continue;
+        }
+        memcpy(tmp, bandwidth + k - 1, sizeof(tmp));
+        smooth[k] = median_of(tmp, 3);
+    }
+    double level = smooth[0];
+    for (int k = 1; k < n; k++) {
+        if (smooth[k] > level)
+            level = smooth[k];
+        if (smooth[k] >= level * SWEEP_CLIFF || k + 1 == n ||
+        smooth[k + 1] >= level * SWEEP_CLIFF)
+            continue;
+        boundary[nu_boundaries++] = k - 1;
+        while (k + 1 < n && smooth[k + 1] < smooth[k] * SWEEP_FALLING)
+            k++;
+        level = smooth[k];
+    }
+    return nu_boundaries;
+}
+
+/*
+ * Measure the bandwidth of the selected memcpy or memset variants while
+ * stepping the working set geometrically from SWEEP_MIN_BYTES to
+ * SWEEP_MAX_BYTES, and print the bandwidth curve of each variant with the
+ * cache boundaries marked. For memcpy, half of the working set is the
+ * source and half the destination.
+ */
+static int do_sweep(int memset_mode, int repeat) {
+    static double bandwidth[MAX_VARIANTS][SWEEP_MAX_POINTS];
+    static int boundary[MAX_VARIANTS][SWEEP_MAX_POINTS];
+    int nu_boundaries[MAX_VARIANTS];
+    int working_set[SWEEP_MAX_POINTS];
+    const int *mask = memset_mode ? memset_mask : memcpy_mask;
+    int nu_variants = memset_mode ? NU_MEMSET_VARIANTS : NU_MEMCPY_VARIANTS;
+    double tmp[MAX_SAMPLES];
+    char name[64];
+    int nu_points = 0;
+    /* The source area followed by the destination area. */
+    uint8_t *buffer = alloc_buffer(SWEEP_MAX_BYTES + 2 * 4096, - 1);
+    if (buffer == NULL) {
+        printf("Unable to allocate sweep buffer.\n");
+        return 0;
+    }
+    for (int k = 0; ; k++) {
+        int size = (int)(SWEEP_MIN_BYTES * pow(2.0, (double)k / sweep_steps))
+            & ~7;
+        if (size > SWEEP_MAX_BYTES)
+            break;
+        working_set[nu_points++] = size;
+    }
+    if (output_format == FORMAT_TEXT)
+        print_cache_sizes();
+    begin_output();
+    for (int j = 0; j < nu_variants; j++) {
+        if (!mask[j])
+            continue;
+        if (memset_mode) {
+            select_variant(j, memset_variant_name[j]);
+            memset_func = memset_variant[j];
+        }
+        else {
+            select_variant(j, memcpy_variant_name[j]);
+            memcpy_func = memcpy_variant[j];
+        }
+        for (int k = 0; k < nu_points; k++) {
+            if (memset_mode) {
+                sweep_dest = buffer + sweep_dst_align;
+                sweep_region = working_set[k];
+            }
+            else {
+                sweep_source = buffer + sweep_src_align;
+                sweep_dest = buffer + SWEEP_MAX_BYTES / 2 + 4096 +
+                    sweep_dst_align;
+                sweep_region = working_set[k] / 2;
+            }
+            sweep_block = sweep_region;
+            if (sweep_stride > 0 && sweep_stride < sweep_region)
+                sweep_block = sweep_stride;
+            sweep_offset = 0;
+            snprintf(name, sizeof(name), "%d bytes working set, %d bytes per call",
+                working_set[k], sweep_block);
+            run_test_repeats(- 1, name, memset_mode ? test_sweep_memset :
+                test_sweep_memcpy, sweep_block, repeat);
+            memcpy(tmp, samples[j], sizeof(double) * nu_samples[j]);
+            bandwidth[j][k] = median_of(tmp, nu_samples[j]);
+        }
+        nu_boundaries[j] = find_sweep_boundaries(bandwidth[j], nu_points,
+            boundary[j]);
+    }
+    if (output_format == FORMAT_JSON) {
+        printf("\n  ],\n  \"cache_boundaries\": {");
+        int first = 1;
+        for (int j = 0; j < nu_variants; j++) {
+            if (!mask[j])
+                continue;
+            printf("%s\n    \"%c\": [", first ? "" : ",",
+                memcpy_variant_to_char(j));
+            for (int b = 0; b < nu_boundaries[j]; b++)
+                printf("%s%d", b > 0 ? ", " : "", working_set[boundary[j][b]]);
+            printf("]");
+            first = 0;
+        }
+        printf("\n  }\n}\n");
+        return 1;
+    }
+    if (output_format == FORMAT_CSV) {
+        for (int j = 0; j < nu_variants; j++) {
+            if (!mask[j])
+                continue;
+            printf("# cache_boundaries_%c=", memcpy_variant_to_char(j));
+            for (int b = 0; b < nu_boundaries[j]; b++)
+                printf("%s%d", b > 0 ? "," : "", working_set[boundary[j][b]]);
+            printf("\n");
+        }
+        return 1;
+    }
+    printf("Median bandwidth in MB/s by working set size in bytes (* marks a cache boundary):\n");
+    printf("working set");
+    for (int j = 0; j < nu_variants; j++)
+        if (mask[j])
+            printf(" %10c ", memcpy_variant_to_char(j));
+    printf("\n");
+    for (int k = 0; k < nu_points; k++) {
+        printf("%11d", working_set[k]);
+        for (int j = 0; j < nu_variants; j++) {
+            if (!mask[j])
+                continue;
+            int marked = 0;
+            for (int b = 0; b < nu_boundaries[j]; b++)
+                if (boundary[j][b] == k)
+                    marked = 1;
+            printf(" %10.2lf%c", bandwidth[j][k], marked ? '*' : ' ');
+        }
+        printf("\n");
+    }
+    for (int j = 0; j < nu_variants; j++) {
+        if (!mask[j])
+            continue;
+        printf("Cache boundaries (%c):", memcpy_variant_to_char(j));
+        for (int b = 0; b < nu_boundaries[j]; b++)
+            printf("%s %d", b > 0 ? "," : "", working_set[boundary[j][b]]);
+        printf(nu_boundaries[j] == 0 ? " none found.\n" : " bytes.\n");
+    }
+    return 1;
+}
+
+/*
+ * Run the selected memcpy or memset variants on each workload. The bytes
+ * of a test are those of a whole pass over the workload's calls.
+ */
+static int do_workloads(int memset_mode, int repeat) {
+    const int *mask = memset_mode ? memset_mask : memcpy_mask;
+    int nu_variants = memset_mode ? NU_MEMSET_VARIANTS : NU_MEMCPY_VARIANTS;
+    const char **variant_name = memset_mode ? memset_variant_name :
+        memcpy_variant_name;
+    struct copy_desc *descs = malloc(sizeof(struct copy_desc) *
+        WORKLOAD_MAX_COUNT);
+    begin_output();
+    for (int t = 0; t < nu_workloads; t++) {
+        int bytes = generate_workload(&workload[t], descs);
+        if (bytes < 0) {
+            printf("Workload %s too large.\n", workload[t].spec);
+            free(descs);
+            return 0;
+        }
+        workload_descs = descs;
+        workload_descs_end = descs + workload[t].count;
+        for (int j = 0; j < nu_variants; j++) {
+            if (!mask[j])
+                continue;
+            select_variant(j, variant_name[j]);
+            if (memset_mode)
+                memset_func = memset_variant[j];
+            else
+                memcpy_func = memcpy_variant[j];
+            run_test_repeats(t, workload[t].spec, memset_mode ?
+                test_workload_memset : test_workload_memcpy, bytes, repeat);
+        }
+        compare_selected_variants(workload[t].spec, mask, nu_variants,
+            variant_name);
+    }
+    end_output();
+    free(descs);
+    return 1;
+}
+
 int main(int argc, char *argv[]) {
     if (argc == 1) {
         usage();
@@ -904,12 +4727,38 @@ int main(int argc, char *argv[]) {
     int command_all = 0;
     int repeat = 5;
     int validate = 0;
+    int fuzz = 0;
+    int duration_specified = 0;
+    const char *tune_file = NULL;
+    int tune_mix[NU_TESTS];
+    const char *tune_mix_str = DEFAULT_TUNE_MIX;
     int memcpy_specified = 0;
     int memset_specified = 0;
+    int memmove_specified = 0;
+    int csum_specified = 0;
+    int crc_specified = 0;
+    int fault_specified = 0;
+    int remap_specified = 0;
+    int vec_specified = 0;
+    const char *cpu_list = NULL;
+    int src_node = - 1;
+    int dst_node = - 1;
     for (int i = 0; i < NU_MEMCPY_VARIANTS; i++)
         memcpy_mask[i] = 0;
     for (int i = 0; i < NU_MEMSET_VARIANTS; i++)
         memset_mask[i] = 0;
+    for (int i = 0; i < NU_MEMMOVE_VARIANTS; i++)
+        memmove_mask[i] = 0;
+    for (int i = 0; i < NU_CSUM_VARIANTS; i++)
+        csum_mask[i] = 0;
+    for (int i = 0; i < NU_CRC_VARIANTS; i++)
+        crc_mask[i] = 0;
+    for (int i = 0; i < NU_FAULT_VARIANTS; i++)
+        fault_mask[i] = 0;
+    for (int i = 0; i < NU_REMAP_VARIANTS; i++)
+        remap_mask[i] = 0;
+    for (int i = 0; i < NU_VEC_VARIANTS; i++)
+        vec_mask[i] = 0;
     for (;;) {
         if (argi >= argc)
             break;
@@ -919,66 +4768,320 @@ int main(int argc, char *argv[]) {
                 printf("Test out of range.\n");
                 return 1;
             }
-            command_test = t;
+            command_test = t;
+            argi += 2;
+            continue;
+        }
+        if (strcasecmp(argv[argi], "--quick") == 0) {
+            test_duration = 1.0;
+            repeat = 2;
+            argi++;
+            continue;
+        }
+        if (strcasecmp(argv[argi], "--all") == 0) {
+            command_all = 1;
+            argi++;
+            continue;
+        }
+        if (strcasecmp(argv[argi], "--list") == 0) {
+            printf("Tests (memcpy):\n");
+            for (int i = 0; i < NU_TESTS; i++)
+                printf("%3d    %s\n", i, test[i].name);
+            printf("Tests (memset):\n");
+            for (int i = 0; i < NU_MEMSET_TESTS; i++)
+                printf("%3d    %s\n", i, memset_test[i].name);
+            printf("Tests (memmove):\n");
+            for (int i = 0; i < NU_MEMMOVE_TESTS; i++)
+                printf("%3d    %s\n", i, memmove_test[i].name);
+            printf("Tests (csum):\n");
+            for (int i = 0; i < NU_CSUM_TESTS; i++)
+                printf("%3d    %s\n", i, csum_test[i].name);
+            printf("Tests (crc):\n");
+            for (int i = 0; i < NU_CRC_TESTS; i++)
+                printf("%3d    %s\n", i, crc_test[i].name);
+            printf("Tests (fault):\n");
+            for (int i = 0; i < NU_FAULT_TESTS; i++)
+                printf("%3d    %s\n", i, fault_test[i].name);
+            printf("Tests (remap):\n");
+            for (int i = 0; i < NU_REMAP_TESTS; i++)
+                printf("%3d    %s\n", i, remap_test[i].name);
+            printf("Tests (vec):\n");
+            for (int i = 0; i < NU_VEC_TESTS; i++)
+                printf("%3d    %s\n", i, vec_test[i].name);
+            printf("memcpy variants:\n");
+            for (int i = 0; i < NU_MEMCPY_VARIANTS; i++)
+                printf("  %c    %s\n", memcpy_variant_to_char(i), memcpy_variant_name[i]);
+            printf("memset variants:\n");
+            for (int i = 0; i < NU_MEMSET_VARIANTS; i++)
+                printf("  %c    %s\n", memcpy_variant_to_char(i), memset_variant_name[i]);
+            printf("memmove variants:\n");
+            for (int i = 0; i < NU_MEMMOVE_VARIANTS; i++)
+                printf("  %c    %s\n", memcpy_variant_to_char(i), memmove_variant_name[i]);
+            printf("csum variants:\n");
+            for (int i = 0; i < NU_CSUM_VARIANTS; i++)
+                printf("  %c    %s\n", memcpy_variant_to_char(i), csum_variant_name[i]);
+            printf("crc variants:\n");
+            for (int i = 0; i < NU_CRC_VARIANTS; i++)
+                printf("  %c    %s\n", memcpy_variant_to_char(i), crc_variant_name[i]);
+            printf("fault variants:\n");
+            for (int i = 0; i < NU_FAULT_VARIANTS; i++)
+                printf("  %c    %s\n", memcpy_variant_to_char(i), fault_variant_name[i]);
+            printf("remap variants:\n");
+            for (int i = 0; i < NU_REMAP_VARIANTS; i++)
+                printf("  %c    %s\n", memcpy_variant_to_char(i), remap_variant_name[i]);
+            printf("vec variants:\n");
+            for (int i = 0; i < NU_VEC_VARIANTS; i++)
+                printf("  %c    %s\n", memcpy_variant_to_char(i), vec_variant_name[i]);
+            return 0;
+        }
+        if (strcasecmp(argv[argi], "--help") == 0) {
+            usage();
+            return 0;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--duration") == 0) {
+            double d = strtod(argv[argi + 1], NULL);
+            if (d < 0.1 || d >= 100.0) {
+                printf("Duration out of range.\n");
+                return 1;
+            }
+            test_duration = d;
+            duration_specified = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--memcpy") == 0) {
+            for (int i = 0; i < NU_MEMCPY_VARIANTS; i++)
+                memcpy_mask[i] = 0;
+            for (int i = 0; i < strlen(argv[argi + 1]); i++)
+                if (char_to_memcpy_variant(argv[argi + 1][i]) >= 0 && char_to_memcpy_variant(argv[argi + 1][i]) < NU_MEMCPY_VARIANTS)
+                    memcpy_mask[char_to_memcpy_variant(argv[argi + 1][i])] = 1;
+            memcpy_specified = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--repeat") == 0) {
+            repeat = atoi(argv[argi + 1]);
+            if (repeat < 1 || repeat >= 1000) {
+                printf("Number of repeats out of range.\n");
+                return 1;
+            }
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--threads") == 0) {
+            nu_threads = atoi(argv[argi + 1]);
+            /* The buffer size must also fit in a size_t on 32-bit targets. */
+            if (nu_threads < 1 || nu_threads > MAX_THREADS ||
+            (size_t)nu_threads > (SIZE_MAX - 4096) / BUFFER_SIZE) {
+                printf("Number of threads out of range.\n");
+                return 1;
+            }
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--cpus") == 0) {
+            cpu_list = argv[argi + 1];
+            argi += 2;
+            continue;
+        }
+        if (strcasecmp(argv[argi], "--numa-matrix") == 0) {
+            numa_mode = 1;
+            argi++;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--src-node") == 0) {
+            src_node = atoi(argv[argi + 1]);
+            numa_mode = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--dst-node") == 0) {
+            dst_node = atoi(argv[argi + 1]);
+            numa_mode = 1;
+            argi += 2;
+            continue;
+        }
+        if (strcasecmp(argv[argi], "--sweep") == 0) {
+            sweep_mode = 1;
+            argi++;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--sweep-steps") == 0) {
+            sweep_steps = atoi(argv[argi + 1]);
+            if (sweep_steps < 1 || sweep_steps > SWEEP_MAX_STEPS) {
+                printf("Sweep steps out of range.\n");
+                return 1;
+            }
+            sweep_mode = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--src-align") == 0) {
+            sweep_src_align = atoi(argv[argi + 1]);
+            if (sweep_src_align < 0 || sweep_src_align > 4095) {
+                printf("Source alignment out of range.\n");
+                return 1;
+            }
+            sweep_mode = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--dst-align") == 0) {
+            sweep_dst_align = atoi(argv[argi + 1]);
+            if (sweep_dst_align < 0 || sweep_dst_align > 4095) {
+                printf("Destination alignment out of range.\n");
+                return 1;
+            }
+            sweep_mode = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--stride") == 0) {
+            sweep_stride = atoi(argv[argi + 1]);
+            if (sweep_stride < 1 || sweep_stride > SWEEP_MAX_BYTES) {
+                printf("Stride out of range.\n");
+                return 1;
+            }
+            sweep_mode = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--workload") == 0) {
+            if (nu_workloads == MAX_WORKLOADS) {
+                printf("Too many workloads.\n");
+                return 1;
+            }
+            if (!parse_workload(argv[argi + 1], &workload[nu_workloads])) {
+                printf("Invalid workload spec %s.\n", argv[argi + 1]);
+                return 1;
+            }
+            nu_workloads++;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--workload-file") == 0) {
+            if (!load_workload_file(argv[argi + 1]))
+                return 1;
+            argi += 2;
+            continue;
+        }
+        if (strcasecmp(argv[argi], "--stats") == 0) {
+            stats_mode = 1;
+            argi++;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--ci") == 0) {
+            target_ci_width = strtod(argv[argi + 1], NULL);
+            if (target_ci_width <= 0 || target_ci_width >= 100.0) {
+                printf("Confidence interval width out of range.\n");
+                return 1;
+            }
+            stats_mode = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--budget") == 0) {
+            time_budget = strtod(argv[argi + 1], NULL);
+            if (time_budget <= 0) {
+                printf("Time budget out of range.\n");
+                return 1;
+            }
+            argi += 2;
+            continue;
+        }
+        if (strcasecmp(argv[argi], "--compare") == 0) {
+            compare_mode = 1;
+            stats_mode = 1;
+            argi++;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--format") == 0) {
+            if (strcasecmp(argv[argi + 1], "text") == 0)
+                output_format = FORMAT_TEXT;
+            else if (strcasecmp(argv[argi + 1], "json") == 0)
+                output_format = FORMAT_JSON;
+            else if (strcasecmp(argv[argi + 1], "csv") == 0)
+                output_format = FORMAT_CSV;
+            else {
+                printf("Unknown output format.\n");
+                return 1;
+            }
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--pages") == 0) {
+            if (strcasecmp(argv[argi + 1], "4k") == 0)
+                page_mode = PAGES_4K;
+            else if (strcasecmp(argv[argi + 1], "thp") == 0)
+                page_mode = PAGES_THP;
+            else if (strcasecmp(argv[argi + 1], "hugetlb") == 0)
+                page_mode = PAGES_HUGETLB;
+            else {
+                printf("Unknown page type.\n");
+                return 1;
+            }
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--victim") == 0) {
+            victim_kb = atoi(argv[argi + 1]);
+            if (victim_kb < 1 || victim_kb > 65536) {
+                printf("Victim buffer size out of range.\n");
+                return 1;
+            }
+            argi += 2;
+            continue;
+        }
+        if (strcasecmp(argv[argi], "--counters") == 0) {
+            counters_mode = 1;
+            argi++;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--cache") == 0) {
+            if (strcasecmp(argv[argi + 1], "warm") == 0)
+                cache_mode = CACHE_WARM;
+            else if (strcasecmp(argv[argi + 1], "cold") == 0)
+                cache_mode = CACHE_COLD;
+            else if (strcasecmp(argv[argi + 1], "l2") == 0)
+                cache_mode = CACHE_L2;
+            else {
+                printf("Unknown cache mode.\n");
+                return 1;
+            }
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--cache-batch") == 0) {
+            cache_batch = atoi(argv[argi + 1]);
+            if (cache_batch < 1 || cache_batch > 1024 * 1024) {
+                printf("Cache batch out of range.\n");
+                return 1;
+            }
             argi += 2;
             continue;
         }
-        if (strcasecmp(argv[argi], "--quick") == 0) {
-            test_duration = 1.0;
-            repeat = 2;
+        if (strcasecmp(argv[argi], "--precompute") == 0) {
+            stream_mode = 1;
             argi++;
             continue;
         }
-        if (strcasecmp(argv[argi], "--all") == 0) {
-            command_all = 1;
+        if (strcasecmp(argv[argi], "--latency") == 0) {
+            latency_mode = 1;
             argi++;
             continue;
         }
-        if (strcasecmp(argv[argi], "--list") == 0) {
-            printf("Tests (memcpy):\n");
-            for (int i = 0; i < NU_TESTS; i++)
-                printf("%3d    %s\n", i, test[i].name);
-            printf("Tests (memset):\n");
-            for (int i = 0; i < NU_MEMSET_TESTS; i++)
-                printf("%3d    %s\n", i, memset_test[i].name);
-            printf("memcpy variants:\n");
-            for (int i = 0; i < NU_MEMCPY_VARIANTS; i++)
-                printf("  %c    %s\n", memcpy_variant_to_char(i), memcpy_variant_name[i]);
-            printf("memset variants:\n");
-            for (int i = 0; i < NU_MEMSET_VARIANTS; i++)
-                printf("  %c    %s\n", memcpy_variant_to_char(i), memset_variant_name[i]);
-            return 0;
-        }
-        if (strcasecmp(argv[argi], "--help") == 0) {
-            usage();
-            return 0;
-        }
-        if (argi + 1 < argc && strcasecmp(argv[argi], "--duration") == 0) {
-            double d = strtod(argv[argi + 1], NULL);
-            if (d < 0.1 || d >= 100.0) {
-                printf("Duration out of range.\n");
-                return 1;
-            }
-            test_duration = d;
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--tune") == 0) {
+            tune_file = argv[argi + 1];
             argi += 2;
             continue;
         }
-        if (argi + 1 < argc && strcasecmp(argv[argi], "--memcpy") == 0) {
-            for (int i = 0; i < NU_MEMCPY_VARIANTS; i++)
-                memcpy_mask[i] = 0;
-            for (int i = 0; i < strlen(argv[argi + 1]); i++)
-                if (char_to_memcpy_variant(argv[argi + 1][i]) >= 0 && char_to_memcpy_variant(argv[argi + 1][i]) < NU_MEMCPY_VARIANTS)
-                    memcpy_mask[char_to_memcpy_variant(argv[argi + 1][i])] = 1;
-            memcpy_specified = 1;
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--mix") == 0) {
+            tune_mix_str = argv[argi + 1];
             argi += 2;
             continue;
         }
-        if (argi + 1 < argc && strcasecmp(argv[argi], "--repeat") == 0) {
-            repeat = atoi(argv[argi + 1]);
-            if (repeat < 1 || repeat >= 1000) {
-                printf("Number of repeats out of range.\n");
-                return 1;
-            }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--trace") == 0) {
+            trace_file = argv[argi + 1];
             argi += 2;
             continue;
         }
@@ -987,6 +5090,12 @@ int main(int argc, char *argv[]) {
             argi++;
             continue;
         }
+        if (strcasecmp(argv[argi], "--fuzz") == 0) {
+            validate = 1;
+            fuzz = 1;
+            argi++;
+            continue;
+        }
         if (argi + 1 < argc && strcasecmp(argv[argi], "--memset") == 0) {
             for (int i = 0; i < NU_MEMSET_VARIANTS; i++)
                 memset_mask[i] = 0;
@@ -997,12 +5106,238 @@ int main(int argc, char *argv[]) {
             argi += 2;
             continue;
         }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--memmove") == 0) {
+            for (int i = 0; i < NU_MEMMOVE_VARIANTS; i++)
+                memmove_mask[i] = 0;
+            for (int i = 0; i < strlen(argv[argi + 1]); i++)
+                if (char_to_memcpy_variant(argv[argi + 1][i]) >= 0 && char_to_memcpy_variant(argv[argi + 1][i]) < NU_MEMMOVE_VARIANTS)
+                    memmove_mask[char_to_memcpy_variant(argv[argi + 1][i])] = 1;
+            memmove_specified = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--csum") == 0) {
+            for (int i = 0; i < NU_CSUM_VARIANTS; i++)
+                csum_mask[i] = 0;
+            for (int i = 0; i < strlen(argv[argi + 1]); i++)
+                if (char_to_memcpy_variant(argv[argi + 1][i]) >= 0 && char_to_memcpy_variant(argv[argi + 1][i]) < NU_CSUM_VARIANTS)
+                    csum_mask[char_to_memcpy_variant(argv[argi + 1][i])] = 1;
+            csum_specified = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--crc") == 0) {
+            for (int i = 0; i < NU_CRC_VARIANTS; i++)
+                crc_mask[i] = 0;
+            for (int i = 0; i < strlen(argv[argi + 1]); i++)
+                if (char_to_memcpy_variant(argv[argi + 1][i]) >= 0 && char_to_memcpy_variant(argv[argi + 1][i]) < NU_CRC_VARIANTS)
+                    crc_mask[char_to_memcpy_variant(argv[argi + 1][i])] = 1;
+            crc_specified = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--fault") == 0) {
+            for (int i = 0; i < NU_FAULT_VARIANTS; i++)
+                fault_mask[i] = 0;
+            for (int i = 0; i < strlen(argv[argi + 1]); i++)
+                if (char_to_memcpy_variant(argv[argi + 1][i]) >= 0 && char_to_memcpy_variant(argv[argi + 1][i]) < NU_FAULT_VARIANTS)
+                    fault_mask[char_to_memcpy_variant(argv[argi + 1][i])] = 1;
+            fault_specified = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--remap") == 0) {
+            for (int i = 0; i < NU_REMAP_VARIANTS; i++)
+                remap_mask[i] = 0;
+            for (int i = 0; i < strlen(argv[argi + 1]); i++)
+                if (char_to_memcpy_variant(argv[argi + 1][i]) >= 0 && char_to_memcpy_variant(argv[argi + 1][i]) < NU_REMAP_VARIANTS)
+                    remap_mask[char_to_memcpy_variant(argv[argi + 1][i])] = 1;
+            remap_specified = 1;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--remap-threshold") == 0) {
+            long t = atol(argv[argi + 1]);
+            if (t < 4096 || t > 1024 * 1024 * 1024) {
+                printf("Remap threshold out of range.\n");
+                return 1;
+            }
+            remap_threshold = t;
+            argi += 2;
+            continue;
+        }
+        if (argi + 1 < argc && strcasecmp(argv[argi], "--vec") == 0) {
+            for (int i = 0; i < NU_VEC_VARIANTS; i++)
+                vec_mask[i] = 0;
+            for (int i = 0; i < strlen(argv[argi + 1]); i++)
+                if (char_to_memcpy_variant(argv[argi + 1][i]) >= 0 && char_to_memcpy_variant(argv[argi + 1][i]) < NU_VEC_VARIANTS)
+                    vec_mask[char_to_memcpy_variant(argv[argi + 1][i])] = 1;
+            vec_specified = 1;
+            argi += 2;
+            continue;
+        }
         printf("Unkown option. Try --help.\n");
         return 1;
     }
 
-    if (memcpy_specified && memset_specified) {
-        printf("Specify only one of --memcpy and --memset.\n");
+    if (memcpy_specified + memset_specified + memmove_specified +
+    csum_specified + crc_specified + fault_specified + remap_specified +
+    vec_specified > 1) {
+        printf("Specify only one of --memcpy, --memset, --memmove, --csum, --crc, --fault, --remap and --vec.\n");
+        return 1;
+    }
+
+    if (latency_mode && nu_threads > 1) {
+        printf("Specify only one of --latency and --threads.\n");
+        return 1;
+    }
+
+    if (victim_kb > 0 && nu_threads > 1) {
+        printf("Specify only one of --victim and --threads.\n");
+        return 1;
+    }
+
+    if (fuzz && !memcpy_specified && !memset_specified) {
+        printf("The --fuzz option requires --memcpy or --memset.\n");
+        return 1;
+    }
+
+    if (numa_mode && !memcpy_specified) {
+        printf("The NUMA placement options require --memcpy.\n");
+        return 1;
+    }
+
+    if (numa_mode && nu_threads > 1) {
+        printf("Specify only one of --numa-matrix (or --src-node and --dst-node) and --threads.\n");
+        return 1;
+    }
+
+    if (numa_mode && trace_file != NULL) {
+        printf("Specify only one of --numa-matrix (or --src-node and --dst-node) and --trace.\n");
+        return 1;
+    }
+
+    if (sweep_mode && !memcpy_specified && !memset_specified) {
+        printf("The sweep options require --memcpy or --memset.\n");
+        return 1;
+    }
+
+    if (sweep_mode && nu_threads > 1) {
+        printf("Specify only one of --sweep and --threads.\n");
+        return 1;
+    }
+
+    if (sweep_mode && trace_file != NULL) {
+        printf("Specify only one of --sweep and --trace.\n");
+        return 1;
+    }
+
+    if (sweep_mode && numa_mode) {
+        printf("Specify only one of --sweep and --numa-matrix (or --src-node and --dst-node).\n");
+        return 1;
+    }
+
+    if (sweep_mode && tune_file != NULL) {
+        printf("Specify only one of --sweep and --tune.\n");
+        return 1;
+    }
+
+    if (cache_mode >= CACHE_COLD && nu_threads > 1) {
+        printf("Specify only one of --cache cold or l2 and --threads.\n");
+        return 1;
+    }
+
+    if (cache_mode >= CACHE_COLD && stream_mode) {
+        printf("Specify only one of --cache cold or l2 and --precompute.\n");
+        return 1;
+    }
+
+    if (stream_mode && !memcpy_specified && !memset_specified) {
+        printf("The --precompute option requires --memcpy or --memset.\n");
+        return 1;
+    }
+
+    if (stream_mode && (nu_threads > 1 || latency_mode || victim_kb > 0)) {
+        printf("Specify only one of --precompute and --threads, --latency or --victim.\n");
+        return 1;
+    }
+
+    if (stream_mode && (trace_file != NULL || tune_file != NULL ||
+    sweep_mode || numa_mode || nu_workloads > 0)) {
+        printf("Specify only one of --precompute and --trace, --tune, --sweep, --numa-matrix or --workload.\n");
+        return 1;
+    }
+
+    if (nu_workloads > 0 && !memcpy_specified && !memset_specified) {
+        printf("Workloads require --memcpy or --memset.\n");
+        return 1;
+    }
+
+    if (nu_workloads > 0 && nu_threads > 1) {
+        printf("Specify only one of --workload and --threads.\n");
+        return 1;
+    }
+
+    if (nu_workloads > 0 && latency_mode) {
+        printf("Specify only one of --workload and --latency.\n");
+        return 1;
+    }
+
+    if (nu_workloads > 0 && (trace_file != NULL || tune_file != NULL ||
+    sweep_mode || numa_mode)) {
+        printf("Specify only one of --workload, --trace, --tune, --sweep and --numa-matrix.\n");
+        return 1;
+    }
+
+    int numa_nodes[MAX_NUMA_NODES];
+    int nu_numa_nodes = get_numa_nodes(numa_nodes);
+    int src_nodes[MAX_NUMA_NODES], dst_nodes[MAX_NUMA_NODES];
+    int nu_src_nodes = 0, nu_dst_nodes = 0;
+    for (int i = 0; i < nu_numa_nodes; i++) {
+        if (src_node < 0 || src_node == numa_nodes[i])
+            src_nodes[nu_src_nodes++] = numa_nodes[i];
+        if (dst_node < 0 || dst_node == numa_nodes[i])
+            dst_nodes[nu_dst_nodes++] = numa_nodes[i];
+    }
+    if (nu_src_nodes == 0) {
+        printf("Source node out of range.\n");
+        return 1;
+    }
+    if (nu_dst_nodes == 0) {
+        printf("Destination node out of range.\n");
+        return 1;
+    }
+
+    if (cpu_list != NULL) {
+        int cpus[CPU_SETSIZE];
+        int nu_cpus = parse_list(cpu_list, cpus, CPU_SETSIZE, CPU_SETSIZE);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int i = 0; i < nu_cpus; i++)
+            CPU_SET(cpus[i], &set);
+        if (nu_cpus == 0 || sched_setaffinity(0, sizeof(set), &set) < 0) {
+            printf("Invalid CPU list.\n");
+            return 1;
+        }
+    }
+
+    if (counters_mode && nu_threads > 1) {
+        printf("Specify only one of --counters and --threads.\n");
+        return 1;
+    }
+
+    if (fault_specified && nu_threads > 1) {
+        printf("Specify only one of --fault and --threads.\n");
+        return 1;
+    }
+
+    if (remap_specified && nu_threads > 1) {
+        printf("Specify only one of --remap and --threads.\n");
+        return 1;
+    }
+
+    if (vec_specified && nu_threads > 1) {
+        printf("Specify only one of --vec and --threads.\n");
         return 1;
     }
 
@@ -1012,17 +5347,142 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    if ((command_test != -1) + command_all != 1 && !validate) {
+    if (command_test != -1 && memmove_specified &&
+    command_test >= NU_MEMMOVE_TESTS) {
+        printf("Test out of range for memmove.\n");
+        return 1;
+    }
+
+    if (command_test != -1 && csum_specified &&
+    command_test >= NU_CSUM_TESTS) {
+        printf("Test out of range for csum.\n");
+        return 1;
+    }
+
+    if (command_test != -1 && crc_specified &&
+    command_test >= NU_CRC_TESTS) {
+        printf("Test out of range for crc.\n");
+        return 1;
+    }
+
+    if (command_test != -1 && fault_specified &&
+    command_test >= NU_FAULT_TESTS) {
+        printf("Test out of range for fault.\n");
+        return 1;
+    }
+
+    if (command_test != -1 && remap_specified &&
+    command_test >= NU_REMAP_TESTS) {
+        printf("Test out of range for remap.\n");
+        return 1;
+    }
+
+    if (command_test != -1 && vec_specified &&
+    command_test >= NU_VEC_TESTS) {
+        printf("Test out of range for vec.\n");
+        return 1;
+    }
+
+    if (trace_file != NULL && memmove_specified) {
+        printf("Specify only one of --trace and --memmove.\n");
+        return 1;
+    }
+
+    if (trace_file != NULL && csum_specified) {
+        printf("Specify only one of --trace and --csum.\n");
+        return 1;
+    }
+
+    if (trace_file != NULL && crc_specified) {
+        printf("Specify only one of --trace and --crc.\n");
+        return 1;
+    }
+
+    if (trace_file != NULL && fault_specified) {
+        printf("Specify only one of --trace and --fault.\n");
+        return 1;
+    }
+
+    if (trace_file != NULL && remap_specified) {
+        printf("Specify only one of --trace and --remap.\n");
+        return 1;
+    }
+
+    if (trace_file != NULL && vec_specified) {
+        printf("Specify only one of --trace and --vec.\n");
+        return 1;
+    }
+
+    if (trace_file != NULL && validate) {
+        printf("Specify only one of --trace and --validate.\n");
+        return 1;
+    }
+
+    deselect_unsupported_variants(memcpy_mask, NU_MEMCPY_VARIANTS,
+        memcpy_variant_name, memcpy_variant_feature);
+    deselect_unsupported_variants(memset_mask, NU_MEMSET_VARIANTS,
+        memset_variant_name, memset_variant_feature);
+    deselect_unsupported_variants(crc_mask, NU_CRC_VARIANTS, crc_variant_name,
+        crc_variant_feature);
+
+    int nu_tune_mix = parse_tune_mix(tune_mix_str, tune_mix);
+    if (nu_tune_mix == 0) {
+        printf("Invalid workload mix.\n");
+        return 1;
+    }
+
+    if ((command_test != -1) + command_all != 1 && !validate && trace_file == NULL &&
+    tune_file == NULL && !numa_mode && !sweep_mode && nu_workloads == 0) {
         printf("Specify only one of --test and --all.\n");
         return 1;
     }
 
-    buffer_alloc = malloc(1024 * 1024 * 32);
-    buffer_page = (uint8_t *)buffer_alloc + ((4096 - ((uintptr_t)buffer_alloc & 4095))
-        & 4095);
-    buffer_chunk = buffer_page + 17 * 32;
-    if (validate)
+    /* Each thread gets its own BUFFER_SIZE slice, plus room for alignment. */
+    buffer_alloc = alloc_buffer((size_t)BUFFER_SIZE * nu_threads + 4096, - 1);
+    if (buffer_alloc == NULL) {
+        if (page_mode == PAGES_HUGETLB)
+            printf("Unable to allocate buffer with hugetlb pages (see /proc/sys/vm/nr_hugepages).\n");
+        else
+            printf("Unable to allocate buffer.\n");
+        return 1;
+    }
+    if (page_mode == PAGES_THP && output_format == FORMAT_TEXT) {
+        char thp_enabled[256] = "";
+        FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+        if (f == NULL || fgets(thp_enabled, sizeof(thp_enabled), f) == NULL ||
+        strstr(thp_enabled, "[never]") != NULL)
+            printf("Transparent huge pages are not available (see "
+                "/sys/kernel/mm/transparent_hugepage/enabled).\n");
+        if (f != NULL)
+            fclose(f);
+    }
+    set_thread_buffers(0);
+    if (victim_kb > 0) {
+        victim_buffer = alloc_buffer(victim_kb * 1024, - 1);
+        if (victim_buffer == NULL) {
+            printf("Unable to allocate victim buffer.\n");
+            return 1;
+        }
+        memset(victim_buffer, 0, victim_kb * 1024);
+    }
+    if (cache_mode >= CACHE_COLD && !validate && !init_cache_eviction()) {
+        printf("Unable to allocate eviction buffer.\n");
+        return 1;
+    }
+    if (validate || tune_file != NULL)
         buffer_compare = malloc(1024 * 1024 * 16);
+    if (counters_mode && !validate && open_counters() == 0) {
+        if (output_format == FORMAT_TEXT)
+            printf("Performance counters are not available (see "
+                "/proc/sys/kernel/perf_event_paranoid), continuing without them.\n");
+        counters_mode = 0;
+    }
+    if (fault_specified && !init_fault_injection()) {
+        printf("Unable to set up the guard pages.\n");
+        return 1;
+    }
+    if (remap_specified)
+        init_remap();
     srand(0);
     random_buffer_1024 = malloc(sizeof(int) * RANDOM_BUFFER_SIZE);
     for (int i = 0; i < RANDOM_BUFFER_SIZE; i++)
@@ -1069,16 +5529,37 @@ int main(int argc, char *argv[]) {
     }
     test[2].bytes = random_buffer_up_to_1023_power_law_total_bytes / RANDOM_BUFFER_SIZE;
     memset_test[2].bytes = test[2].bytes;
+    csum_test[0].bytes = test[2].bytes;
+    init_vec_descs();
+    vec_test[0].bytes = test[1].bytes * VEC_BATCH_SIZE;
+    vec_test[1].bytes = vec_test[0].bytes;
+    vec_test[2].bytes = vec_test[0].bytes;
+    vec_test[3].bytes = test[1].bytes * 4;
 
+#ifndef HOST
+    /* The host backend is written in C and handles any size_t. */
     if (sizeof(size_t) != sizeof(int)) {
         printf("sizeof(size_t) != sizeof(int), unable to directly replace memcpy.\n");
         return 1;
     }
+#endif
 
     int start_test, end_test;
     start_test = 0;
     if (memset_specified)
         end_test = NU_MEMSET_TESTS - 1;
+    else if (memmove_specified)
+        end_test = NU_MEMMOVE_TESTS - 1;
+    else if (csum_specified)
+        end_test = NU_CSUM_TESTS - 1;
+    else if (crc_specified)
+        end_test = NU_CRC_TESTS - 1;
+    else if (fault_specified)
+        end_test = NU_FAULT_TESTS - 1;
+    else if (remap_specified)
+        end_test = NU_REMAP_TESTS - 1;
+    else if (vec_specified)
+        end_test = NU_VEC_TESTS - 1;
     else
         end_test = NU_TESTS - 1;
     if (command_test != - 1) {
@@ -1090,26 +5571,144 @@ int main(int argc, char *argv[]) {
             if (memcpy_mask[j]) {
                 printf("%s:\n", memcpy_variant_name[j]);
                 memcpy_func = memcpy_variant[j];
-                do_validation(repeat);
+                if (fuzz)
+                    do_fuzz(repeat);
+                else
+                    do_validation(repeat);
             }
         for (int j = 0; j < NU_MEMSET_VARIANTS; j++)
             if (memset_mask[j]) {
                 printf("%s:\n", memset_variant_name[j]);
                 memset_func = memset_variant[j];
-                do_validation_memset(repeat);
+                if (fuzz)
+                    do_fuzz_memset(repeat);
+                else
+                    do_validation_memset(repeat);
+            }
+        for (int j = 0; j < NU_MEMMOVE_VARIANTS; j++)
+            if (memmove_mask[j]) {
+                printf("%s:\n", memmove_variant_name[j]);
+                memmove_func = memmove_variant[j];
+                do_validation_memmove(repeat);
+            }
+        for (int j = 0; j < NU_CSUM_VARIANTS; j++)
+            if (csum_mask[j]) {
+                printf("%s:\n", csum_variant_name[j]);
+                csum_copy_func = csum_variant[j];
+                do_validation_csum(repeat);
+            }
+        for (int j = 0; j < NU_CRC_VARIANTS; j++)
+            if (crc_mask[j]) {
+                printf("%s:\n", crc_variant_name[j]);
+                crc_copy_func = crc_variant[j];
+                do_validation_crc(repeat);
+            }
+        for (int j = 0; j < NU_FAULT_VARIANTS; j++)
+            if (fault_mask[j]) {
+                printf("%s:\n", fault_variant_name[j]);
+                memcpy_func = fault_variant[j];
+                fault_to_user = fault_variant_to_user[j];
+                do_validation_fault(repeat);
+            }
+        for (int j = 0; j < NU_REMAP_VARIANTS; j++)
+            if (remap_mask[j]) {
+                printf("%s:\n", remap_variant_name[j]);
+                memcpy_func = remap_variant[j];
+                do_validation_remap(repeat);
+            }
+        for (int j = 0; j < NU_VEC_VARIANTS; j++)
+            if (vec_mask[j]) {
+                printf("%s:\n", vec_variant_name[j]);
+                vec_func = vec_variant[j];
+                do_validation_vec(repeat);
             }
         return 0;
     }
+    if (trace_file != NULL && !load_trace(trace_file))
+        return 1;
+    if (tune_file != NULL) {
+        char mix_description[256];
+        if (trace_file != NULL) {
+            if (trace_nu_memcpy_records == 0) {
+                printf("The trace contains no memcpy calls.\n");
+                return 1;
+            }
+            tune_mix[0] = - 1;
+            nu_tune_mix = 1;
+            snprintf(mix_description, sizeof(mix_description), "trace %s",
+                trace_file);
+        }
+        else
+            snprintf(mix_description, sizeof(mix_description), "tests %s",
+                tune_mix_str);
+        if (!duration_specified)
+            test_duration = DEFAULT_TUNE_DURATION;
+        return do_tune(tune_file, tune_mix, nu_tune_mix, mix_description,
+            repeat) ? 0 : 1;
+    }
+    if (trace_file != NULL) {
+        char trace_name[128];
+        if (memcpy_specified && trace_nu_memcpy_records == 0) {
+            printf("The trace contains no memcpy calls.\n");
+            return 1;
+        }
+        if (memset_specified && trace_nu_memset_records == 0) {
+            printf("The trace contains no memset calls.\n");
+            return 1;
+        }
+        begin_output();
+        if (memcpy_specified) {
+            snprintf(trace_name, sizeof(trace_name), "trace (%d memcpy calls, average %d bytes)",
+                trace_nu_memcpy_records, trace_memcpy_bytes);
+            for (int j = 0; j < NU_MEMCPY_VARIANTS; j++)
+                if (memcpy_mask[j]) {
+                    select_variant(j, memcpy_variant_name[j]);
+                    memcpy_func = memcpy_variant[j];
+                    run_test_repeats(- 1, trace_name, test_trace_memcpy,
+                        trace_memcpy_bytes, repeat);
+                }
+            compare_selected_variants(trace_name, memcpy_mask,
+                NU_MEMCPY_VARIANTS, memcpy_variant_name);
+        }
+        else {
+            snprintf(trace_name, sizeof(trace_name), "trace (%d memset calls, average %d bytes)",
+                trace_nu_memset_records, trace_memset_bytes);
+            for (int j = 0; j < NU_MEMSET_VARIANTS; j++)
+                if (memset_mask[j]) {
+                    select_variant(j, memset_variant_name[j]);
+                    memset_func = memset_variant[j];
+                    run_test_repeats(- 1, trace_name, test_trace_memset,
+                        trace_memset_bytes, repeat);
+                }
+            compare_selected_variants(trace_name, memset_mask,
+                NU_MEMSET_VARIANTS, memset_variant_name);
+        }
+        end_output();
+        exit(0);
+    }
+    if (numa_mode)
+        return do_numa_matrix(src_nodes, nu_src_nodes, dst_nodes, nu_dst_nodes,
+            repeat) ? 0 : 1;
+    if (sweep_mode) {
+        if (!duration_specified)
+            test_duration = DEFAULT_SWEEP_DURATION;
+        return do_sweep(memset_specified, repeat) ? 0 : 1;
+    }
+    if (nu_workloads > 0)
+        return do_workloads(memset_specified, repeat) ? 0 : 1;
+    begin_output();
     if (!memcpy_specified)
         goto skip_memcpy_test;
     for (int t = start_test; t <= end_test; t++) {
         for (int j = 0; j < NU_MEMCPY_VARIANTS; j++)
             if (memcpy_mask[j]) {
-                printf("%s:\n", memcpy_variant_name[j]);
+                select_variant(j, memcpy_variant_name[j]);
                 memcpy_func = memcpy_variant[j];
-                for (int i = 0; i < repeat; i++)
-                    do_test(test[t].name, test[t].test_func, test[t].bytes);
+                run_test_repeats(t, test[t].name, test[t].test_func,
+                    test[t].bytes, repeat);
             }
+        compare_selected_variants(test[t].name, memcpy_mask,
+            NU_MEMCPY_VARIANTS, memcpy_variant_name);
     }
 skip_memcpy_test:
     if (!memset_specified)
@@ -1122,22 +5721,112 @@ skip_memcpy_test:
                     test_alignment);
                 for (int j = 0; j < NU_MEMSET_VARIANTS; j++)
                     if (memset_mask[j]) {
-                        printf("%s:\n", memset_variant_name[j]);
+                        select_variant(j, memset_variant_name[j]);
                         memset_func = memset_variant[j];
-                        for (int i = 0; i < repeat; i++)
-                            do_test(test_name, memset_test[t].test_func, memset_test[t].bytes);
+                        run_test_repeats(t, test_name, memset_test[t].test_func,
+                            memset_test[t].bytes, repeat);
                     }
+                compare_selected_variants(test_name, memset_mask,
+                    NU_MEMSET_VARIANTS, memset_variant_name);
             }
             continue;
         }
         for (int j = 0; j < NU_MEMSET_VARIANTS; j++)
             if (memset_mask[j]) {
-                printf("%s:\n", memset_variant_name[j]);
+                select_variant(j, memset_variant_name[j]);
                 memset_func = memset_variant[j];
-                for (int i = 0; i < repeat; i++)
-                    do_test(memset_test[t].name, memset_test[t].test_func, memset_test[t].bytes);
+                run_test_repeats(t, memset_test[t].name, memset_test[t].test_func,
+                    memset_test[t].bytes, repeat);
             }
+        compare_selected_variants(memset_test[t].name, memset_mask,
+            NU_MEMSET_VARIANTS, memset_variant_name);
     }
 skip_memset_test:
+    if (!memmove_specified)
+        goto skip_memmove_test;
+    for (int t = start_test; t <= end_test; t++) {
+        for (int j = 0; j < NU_MEMMOVE_VARIANTS; j++)
+            if (memmove_mask[j]) {
+                select_variant(j, memmove_variant_name[j]);
+                memmove_func = memmove_variant[j];
+                run_test_repeats(t, memmove_test[t].name, memmove_test[t].test_func,
+                    memmove_test[t].bytes, repeat);
+            }
+        compare_selected_variants(memmove_test[t].name, memmove_mask,
+            NU_MEMMOVE_VARIANTS, memmove_variant_name);
+    }
+skip_memmove_test:
+    if (!csum_specified)
+        goto skip_csum_test;
+    for (int t = start_test; t <= end_test; t++) {
+        for (int j = 0; j < NU_CSUM_VARIANTS; j++)
+            if (csum_mask[j]) {
+                select_variant(j, csum_variant_name[j]);
+                csum_copy_func = csum_variant[j];
+                run_test_repeats(t, csum_test[t].name, csum_test[t].test_func,
+                    csum_test[t].bytes, repeat);
+            }
+        compare_selected_variants(csum_test[t].name, csum_mask,
+            NU_CSUM_VARIANTS, csum_variant_name);
+    }
+skip_csum_test:
+    if (!crc_specified)
+        goto skip_crc_test;
+    for (int t = start_test; t <= end_test; t++) {
+        for (int j = 0; j < NU_CRC_VARIANTS; j++)
+            if (crc_mask[j]) {
+                select_variant(j, crc_variant_name[j]);
+                crc_copy_func = crc_variant[j];
+                run_test_repeats(t, crc_test[t].name, crc_test[t].test_func,
+                    crc_test[t].bytes, repeat);
+            }
+        compare_selected_variants(crc_test[t].name, crc_mask,
+            NU_CRC_VARIANTS, crc_variant_name);
+    }
+skip_crc_test:
+    if (!fault_specified)
+        goto skip_fault_test;
+    for (int t = start_test; t <= end_test; t++) {
+        for (int j = 0; j < NU_FAULT_VARIANTS; j++)
+            if (fault_mask[j]) {
+                select_variant(j, fault_variant_name[j]);
+                memcpy_func = fault_variant[j];
+                fault_to_user = fault_variant_to_user[j];
+                run_test_repeats(t, fault_test[t].name, fault_test[t].test_func,
+                    fault_test[t].bytes, repeat);
+            }
+        compare_selected_variants(fault_test[t].name, fault_mask,
+            NU_FAULT_VARIANTS, fault_variant_name);
+    }
+skip_fault_test:
+    if (!remap_specified)
+        goto skip_remap_test;
+    for (int t = start_test; t <= end_test; t++) {
+        for (int j = 0; j < NU_REMAP_VARIANTS; j++)
+            if (remap_mask[j]) {
+                select_variant(j, remap_variant_name[j]);
+                memcpy_func = remap_variant[j];
+                run_test_repeats(t, remap_test[t].name, remap_test[t].test_func,
+                    remap_test[t].bytes, repeat);
+            }
+        compare_selected_variants(remap_test[t].name, remap_mask,
+            NU_REMAP_VARIANTS, remap_variant_name);
+    }
+skip_remap_test:
+    if (!vec_specified)
+        goto skip_vec_test;
+    for (int t = start_test; t <= end_test; t++) {
+        for (int j = 0; j < NU_VEC_VARIANTS; j++)
+            if (vec_mask[j]) {
+                select_variant(j, vec_variant_name[j]);
+                vec_func = vec_variant[j];
+                run_test_repeats(t, vec_test[t].name, vec_test[t].test_func,
+                    vec_test[t].bytes, repeat);
+            }
+        compare_selected_variants(vec_test[t].name, vec_mask,
+            NU_VEC_VARIANTS, vec_variant_name);
+    }
+skip_vec_test:
+    end_output();
     exit(0);
 }
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2013 Harm Hanemaaijer <fgenfb@yahoo.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * libfastmem.so: exports memcpy, memmove, memset and bzero implemented with
+ * the new_arm.S variants (host.c on the host backend), for use with
+ * LD_PRELOAD. Build it with "make libfastmem.so" and run
+ *
+ *     LD_PRELOAD=./libfastmem.so <program>
+ *
+ * The functions dispatch through GNU indirect functions, whose resolvers
+ * pick the variant for the cache line size of the CPU when the library is
+ * loaded:
+ *
+ * - 64 bytes: memcpy_variant 64, 3, 0, 0, memmove_variant 64, 3, 0 and
+ *   memset_variant 0 (the MEMCPY_REPLACEMENT_SUNXI/MEMSET_REPLACEMENT_SUNXI
+ *   configuration).
+ * - 32 bytes: memcpy_variant 32, 3, 8, 0, memmove_variant 32, 3, 8 and
+ *   memset_variant 32 (the MEMCPY_REPLACEMENT_RPI/MEMSET_REPLACEMENT_RPI
+ *   configuration).
+ *
+ * ARM Linux doesn't report the cache line size to user space, so it is
+ * derived from the architecture: 64 bytes for ARMv7 and later, 32 bytes for
+ * ARMv6. The architecture is taken from AT_PLATFORM, or from AT_HWCAP when
+ * AT_PLATFORM is not available. On x86 the size is read with cpuid.
+ *
+ * This file must be compiled with -fno-builtin so that the definitions of
+ * memcpy, memmove, memset and bzero are not treated as the builtins.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/auxv.h>
+#if defined(HOST) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+#include "new_arm.h"
+
+#ifndef HWCAP_ARM_THUMBEE
+#define HWCAP_ARM_THUMBEE 2048
+#endif
+#ifndef HWCAP_ARM_NEON
+#define HWCAP_ARM_NEON 4096
+#endif
+#ifndef HWCAP_ARM_VFPv3
+#define HWCAP_ARM_VFPv3 8192
+#endif
+
+typedef void *(*memcpy_func_type)(void *dest, const void *src, size_t n);
+typedef void *(*memset_func_type)(void *dest, int c, size_t n);
+typedef void (*bzero_func_type)(void *dest, size_t n);
+
+/*
+ * Called from the resolvers, which run while the program is being
+ * relocated, so only getauxval() and cpuid are used.
+ */
+static int get_cache_line_size() {
+#ifdef HOST
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    /* The CLFLUSH line size in units of 8 bytes. */
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ebx >> 8) & 0xFF) != 0)
+        return ((ebx >> 8) & 0xFF) * 8;
+#endif
+    return 64;
+#else
+    const char *platform = (const char *)getauxval(AT_PLATFORM);
+    if (platform != NULL && platform[0] == 'v' && platform[1] >= '0' &&
+    platform[1] <= '9')
+        return platform[1] >= '7' ? 64 : 32;
+    if (getauxval(AT_HWCAP) & (HWCAP_ARM_THUMBEE | HWCAP_ARM_NEON |
+    HWCAP_ARM_VFPv3))
+        return 64;
+    return 32;
+#endif
+}
+
+static void bzero_align_0(void *dest, size_t n) {
+    memset_new_align_0(dest, 0, n);
+}
+
+static void bzero_align_32(void *dest, size_t n) {
+    memset_new_align_32(dest, 0, n);
+}
+
+static memcpy_func_type resolve_memcpy() {
+    if (get_cache_line_size() >= 64)
+        return memcpy_new_line_size_64_preload_192;
+    return memcpy_new_line_size_32_preload_96;
+}
+
+static memcpy_func_type resolve_memmove() {
+    if (get_cache_line_size() >= 64)
+        return memmove_new_line_size_64_preload_192;
+    return memmove_new_line_size_32_preload_96;
+}
+
+static memset_func_type resolve_memset() {
+    if (get_cache_line_size() >= 64)
+        return memset_new_align_0;
+    return memset_new_align_32;
+}
+
+static bzero_func_type resolve_bzero() {
+    if (get_cache_line_size() >= 64)
+        return bzero_align_0;
+    return bzero_align_32;
+}
+
+/*
+ * The indirect functions are local, and the exported functions jump to
+ * them. Libraries that are relocated before libfastmem.so (all of them,
+ * when it is preloaded) bind to the exported functions, which are ordinary
+ * symbols; binding directly to an indirect function in an object that
+ * hasn't been relocated yet makes ld.so warn about it.
+ */
+
+static void *fastmem_memcpy(void *dest, const void *src, size_t n)
+    __attribute__((ifunc("resolve_memcpy")));
+static void *fastmem_memmove(void *dest, const void *src, size_t n)
+    __attribute__((ifunc("resolve_memmove")));
+static void *fastmem_memset(void *dest, int c, size_t n)
+    __attribute__((ifunc("resolve_memset")));
+static void fastmem_bzero(void *dest, size_t n)
+    __attribute__((ifunc("resolve_bzero")));
+
+void *memcpy(void *dest, const void *src, size_t n) {
+    return fastmem_memcpy(dest, src, n);
+}
+
+void *memmove(void *dest, const void *src, size_t n) {
+    return fastmem_memmove(dest, src, n);
+}
+
+void *memset(void *dest, int c, size_t n) {
+    return fastmem_memset(dest, c, n);
+}
+
+void bzero(void *dest, size_t n) {
+    fastmem_bzero(dest, n);
+}
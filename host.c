@@ -0,0 +1,851 @@
+/*
+ * Copyright (C) 2013 Harm Hanemaaijer <fgenfb@yahoo.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * Host backend. This file provides C implementations of all functions
+ * declared in asm.h and new_arm.h so that the benchmark can be built and
+ * run on hosts other than ARM (select it with "make HOST=x86_64" or
+ * "make HOST=generic").
+ *
+ * The "original" kernel functions are plain portable C and serve as a
+ * baseline. The optimized functions follow the structure of their ARM
+ * counterparts (fast path, write alignment, prefetching main loop) using
+ * the widest vector type available: AVX2 (32 bytes) when compiled with
+ * -mavx2, SSE2 (16 bytes) on x86-64, or 64-bit words when HOST_NO_SIMD is
+ * defined.
+ *
+ * This file must be compiled with -fno-builtin and
+ * -fno-tree-loop-distribute-patterns so that the compiler doesn't turn
+ * the copy loops back into calls to the libc memcpy/memset.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "asm.h"
+#include "new_arm.h"
+#include "host_defines.h"
+
+#ifndef HOST_NO_SIMD
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#endif
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+#if !defined(HOST_NO_SIMD) && defined(__AVX2__)
+
+#define VEC_BYTES 32
+typedef __m256i vec_t;
+#define vec_load(p) _mm256_loadu_si256((const __m256i *)(p))
+#define vec_store(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define vec_stream(p, v) _mm256_stream_si256((__m256i *)(p), v)
+#define vec_stream_fence() _mm_sfence()
+#define vec_set1(c) _mm256_set1_epi8(c)
+
+#elif !defined(HOST_NO_SIMD) && defined(__SSE2__)
+
+#define VEC_BYTES 16
+typedef __m128i vec_t;
+#define vec_load(p) _mm_loadu_si128((const __m128i *)(p))
+#define vec_store(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define vec_stream(p, v) _mm_stream_si128((__m128i *)(p), v)
+#define vec_stream_fence() _mm_sfence()
+#define vec_set1(c) _mm_set1_epi8(c)
+
+#else
+
+#define VEC_BYTES 8
+typedef uint64_t vec_t;
+
+static ALWAYS_INLINE vec_t vec_load(const uint8_t *p) {
+    vec_t v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static ALWAYS_INLINE void vec_store(uint8_t *p, vec_t v) {
+    __builtin_memcpy(p, &v, sizeof(v));
+}
+
+/* There are no portable streaming stores. */
+#define vec_stream(p, v) vec_store(p, v)
+#define vec_stream_fence()
+
+#define vec_set1(c) ((vec_t)0x0101010101010101ULL * (uint8_t)(c))
+
+#endif
+
+static ALWAYS_INLINE uint64_t load64(const uint8_t *p) {
+    uint64_t w;
+    __builtin_memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static ALWAYS_INLINE void store64(uint8_t *p, uint64_t w) {
+    __builtin_memcpy(p, &w, sizeof(w));
+}
+
+static ALWAYS_INLINE uint32_t load32(const uint8_t *p) {
+    uint32_t w;
+    __builtin_memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static ALWAYS_INLINE void store32(uint8_t *p, uint32_t w) {
+    __builtin_memcpy(p, &w, sizeof(w));
+}
+
+static ALWAYS_INLINE void copy_bytes(uint8_t *d, const uint8_t *s, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        d[i] = s[i];
+}
+
+/*
+ * Copy n <= 2 * VEC_BYTES bytes using (possibly overlapping) unaligned
+ * accesses of the largest suitable width.
+ */
+static ALWAYS_INLINE void copy_small_unaligned(uint8_t *d, const uint8_t *s,
+size_t n) {
+    if (n >= VEC_BYTES) {
+        vec_t a = vec_load(s);
+        vec_t b = vec_load(s + n - VEC_BYTES);
+        vec_store(d, a);
+        vec_store(d + n - VEC_BYTES, b);
+    }
+    else if (VEC_BYTES > 16 && n >= 16) {
+        uint64_t a = load64(s);
+        uint64_t b = load64(s + 8);
+        uint64_t c = load64(s + n - 16);
+        uint64_t e = load64(s + n - 8);
+        store64(d, a);
+        store64(d + 8, b);
+        store64(d + n - 16, c);
+        store64(d + n - 8, e);
+    }
+    else if (n >= 8) {
+        uint64_t a = load64(s);
+        uint64_t b = load64(s + n - 8);
+        store64(d, a);
+        store64(d + n - 8, b);
+    }
+    else if (n >= 4) {
+        uint32_t a = load32(s);
+        uint32_t b = load32(s + n - 4);
+        store32(d, a);
+        store32(d + n - 4, b);
+    }
+    else if (n > 0) {
+        uint8_t a = s[0];
+        uint8_t b = s[n / 2];
+        uint8_t c = s[n - 1];
+        d[0] = a;
+        d[n / 2] = b;
+        d[n - 1] = c;
+    }
+}
+
+/*
+ * Copy n bytes avoiding unaligned word accesses, the equivalent of the
+ * aligned_access small size and tail handling in new_arm.S.
+ */
+static ALWAYS_INLINE void copy_small_aligned(uint8_t *d, const uint8_t *s,
+size_t n) {
+    if ((((uintptr_t)d | (uintptr_t)s) & 3) == 0) {
+        for (; n >= 4; n -= 4, d += 4, s += 4)
+            *(uint32_t *)d = *(const uint32_t *)s;
+    }
+    copy_bytes(d, s, n);
+}
+
+/*
+ * Copy a block of line_size bytes (a multiple of VEC_BYTES). All loads are
+ * issued before the stores, like the ldmia/stmia pairs of the ARM main loop.
+ */
+static ALWAYS_INLINE void copy_line(uint8_t *d, const uint8_t *s,
+int line_size) {
+    vec_t v[line_size / VEC_BYTES];
+    for (int i = 0; i < line_size / VEC_BYTES; i++)
+        v[i] = vec_load(s + i * VEC_BYTES);
+    for (int i = 0; i < line_size / VEC_BYTES; i++)
+        vec_store(d + i * VEC_BYTES, v[i]);
+}
+
+/*
+ * The C equivalent of the memcpy_variant macro in new_arm.S, with the same
+ * parameters:
+ *
+ * - line_size is the cache line size used for prefetches. Must be a
+ *   multiple of VEC_BYTES.
+ * - prefetch_distance is the number of cache lines to look ahead.
+ * - write_align is the write alignment enforced before the main loop for
+ *   larger sizes, 0 or a power of two.
+ * - aligned_access must be 0 or 1. When enabled, small sizes and the tail
+ *   are copied without overlapping unaligned accesses.
+ *
+ * Because all arguments are constants at each call site, the function is
+ * specialized for every instantiation.
+ */
+static ALWAYS_INLINE void *memcpy_variant(void *dest, const void *src,
+size_t n, int line_size, int prefetch_distance, int write_align,
+int aligned_access) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+
+    if (n <= SMALL_SIZE_THRESHOLD && (aligned_access || n <= 2 * VEC_BYTES)) {
+        if (aligned_access)
+            copy_small_aligned(d, s, n);
+        else
+            copy_small_unaligned(d, s, n);
+        return dest;
+    }
+    __builtin_prefetch(s);
+    if (n <= 2 * VEC_BYTES && !aligned_access) {
+        copy_small_unaligned(d, s, n);
+        return dest;
+    }
+    /* The write alignment may copy up to write_align + VEC_BYTES bytes. */
+    if (n > FAST_PATH_THRESHOLD && n > write_align + VEC_BYTES) {
+        /* Handle write alignment. */
+        if (write_align > 0) {
+            size_t align = (-(uintptr_t)d) & (write_align - 1);
+            if (aligned_access)
+                copy_small_aligned(d, s, align);
+            else
+                /* Bytes beyond align will be copied again, harmlessly. */
+                for (size_t i = 0; i < align; i += VEC_BYTES)
+                    vec_store(d + i, vec_load(s + i));
+            d += align;
+            s += align;
+            n -= align;
+        }
+        /* Main loop with prefetches, stopping at the end of the source. */
+        size_t prefetch_bytes = (size_t)prefetch_distance * line_size;
+        while (n >= prefetch_bytes + line_size) {
+            __builtin_prefetch(s + prefetch_bytes);
+            copy_line(d, s, line_size);
+            d += line_size;
+            s += line_size;
+            n -= line_size;
+        }
+        while (n >= line_size) {
+            copy_line(d, s, line_size);
+            d += line_size;
+            s += line_size;
+            n -= line_size;
+        }
+    }
+    /* Fast path, also handles the remainder of larger sizes. */
+    while (n >= VEC_BYTES) {
+        vec_store(d, vec_load(s));
+        d += VEC_BYTES;
+        s += VEC_BYTES;
+        n -= VEC_BYTES;
+    }
+    if (n > 0) {
+        if (aligned_access)
+            copy_small_aligned(d, s, n);
+        else
+            /* At least VEC_BYTES have been copied, so overlap is allowed. */
+            vec_store(d + n - VEC_BYTES, vec_load(s + n - VEC_BYTES));
+    }
+    return dest;
+}
+
+/*
+ * The C equivalent of the memcpy_large_variant macro in new_arm.S. In the
+ * large copy mode, the source is prefetched with the non-temporal hint and
+ * the destination is written with streaming stores in 64-byte blocks.
+ */
+static ALWAYS_INLINE void *memcpy_large_variant(void *dest, const void *src,
+size_t n, int line_size, int prefetch_distance, int write_align,
+int large_prefetch_distance) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+
+    if (n < LARGE_COPY_THRESHOLD)
+        return memcpy_variant(dest, src, n, line_size, prefetch_distance,
+            write_align, 0);
+    /*
+     * Copy the first 64 bytes and continue at the next 64-byte aligned
+     * destination address.
+     */
+    copy_line(d, s, 64);
+    size_t align = 64 - ((uintptr_t)d & 63);
+    d += align;
+    s += align;
+    n -= align;
+    size_t prefetch_bytes = (size_t)large_prefetch_distance * line_size;
+    while (n >= 64) {
+        for (int i = 0; i < 64; i += line_size)
+            __builtin_prefetch(s + prefetch_bytes + i, 0, 0);
+        vec_t v[64 / VEC_BYTES];
+        for (int i = 0; i < 64 / VEC_BYTES; i++)
+            v[i] = vec_load(s + i * VEC_BYTES);
+        for (int i = 0; i < 64 / VEC_BYTES; i++)
+            vec_stream(d + i * VEC_BYTES, v[i]);
+        d += 64;
+        s += 64;
+        n -= 64;
+    }
+    vec_stream_fence();
+    /* Copy the last 64 bytes, overlapping the bytes already copied. */
+    copy_line(d + n - 64, s + n - 64, 64);
+    return dest;
+}
+
+/*
+ * The C equivalent of the memmove_variant macro in new_arm.S. When the
+ * buffers overlap, every block is loaded before it is stored and the blocks
+ * are processed in the direction of the copy, so the overlapping (and
+ * therefore order dependent) accesses of memcpy_variant are only used on
+ * whole blocks. write_align must be 0 or a power of two.
+ */
+static ALWAYS_INLINE void *memmove_variant(void *dest, const void *src,
+size_t n, int line_size, int prefetch_distance, int write_align) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+    size_t prefetch_bytes = (size_t)prefetch_distance * line_size;
+
+    if ((uintptr_t)d - (uintptr_t)s >= n &&
+    (uintptr_t)s - (uintptr_t)d >= n)
+        return memcpy_variant(dest, src, n, line_size, prefetch_distance,
+            write_align, 0);
+    /* copy_small_unaligned() loads everything before storing. */
+    if (n <= 2 * VEC_BYTES) {
+        copy_small_unaligned(d, s, n);
+        return dest;
+    }
+    if (d < s) {
+        /* Forward copy, the destination is below the source. */
+        if (write_align > 0 && n >= write_align) {
+            size_t align = (-(uintptr_t)d) & (write_align - 1);
+            n -= align;
+            for (; align >= VEC_BYTES; align -= VEC_BYTES) {
+                vec_store(d, vec_load(s));
+                d += VEC_BYTES;
+                s += VEC_BYTES;
+            }
+            copy_small_unaligned(d, s, align);
+            d += align;
+            s += align;
+        }
+        while (n >= line_size) {
+            __builtin_prefetch(s + prefetch_bytes);
+            copy_line(d, s, line_size);
+            d += line_size;
+            s += line_size;
+            n -= line_size;
+        }
+        while (n >= VEC_BYTES) {
+            vec_store(d, vec_load(s));
+            d += VEC_BYTES;
+            s += VEC_BYTES;
+            n -= VEC_BYTES;
+        }
+        copy_small_unaligned(d, s, n);
+    }
+    else if (d > s) {
+        /* Backward copy from the end, the destination is above the source. */
+        d += n;
+        s += n;
+        if (write_align > 0 && n >= write_align) {
+            size_t align = (uintptr_t)d & (write_align - 1);
+            n -= align;
+            for (; align >= VEC_BYTES; align -= VEC_BYTES) {
+                d -= VEC_BYTES;
+                s -= VEC_BYTES;
+                vec_store(d, vec_load(s));
+            }
+            d -= align;
+            s -= align;
+            copy_small_unaligned(d, s, align);
+        }
+        while (n >= line_size) {
+            d -= line_size;
+            s -= line_size;
+            n -= line_size;
+            __builtin_prefetch(s - prefetch_bytes);
+            copy_line(d, s, line_size);
+        }
+        while (n >= VEC_BYTES) {
+            d -= VEC_BYTES;
+            s -= VEC_BYTES;
+            n -= VEC_BYTES;
+            vec_store(d, vec_load(s));
+        }
+        copy_small_unaligned(d - n, s - n, n);
+    }
+    return dest;
+}
+
+/*
+ * The C equivalent of the memset_variant macro in new_arm.S. write_align
+ * must be 0 or a power of two <= 32.
+ */
+static ALWAYS_INLINE void *memset_variant(void *dest, int c, size_t n,
+int write_align) {
+    uint8_t *d = dest;
+
+    if (n < 8) {
+        for (size_t i = 0; i < n; i++)
+            d[i] = c;
+        return dest;
+    }
+    uint64_t w = 0x0101010101010101ULL * (uint8_t)c;
+    if (n < VEC_BYTES) {
+        if (n >= 16) {
+            store64(d + 8, w);
+            store64(d + n - 16, w);
+        }
+        store64(d, w);
+        store64(d + n - 8, w);
+        return dest;
+    }
+    vec_t v = vec_set1(c);
+    if (n >= 64) {
+        if (write_align > 0) {
+            size_t align = (-(uintptr_t)d) & (write_align - 1);
+            for (size_t i = 0; i < align; i += VEC_BYTES)
+                vec_store(d + i, v);
+            d += align;
+            n -= align;
+        }
+        for (; n >= 64; n -= 64, d += 64)
+            for (int i = 0; i < 64; i += VEC_BYTES)
+                vec_store(d + i, v);
+    }
+    for (; n >= VEC_BYTES; n -= VEC_BYTES, d += VEC_BYTES)
+        vec_store(d, v);
+    if (n > 0)
+        vec_store(d + n - VEC_BYTES, v);
+    return dest;
+}
+
+/*
+ * host_tune.c includes this file with HOST_TUNE_GRID defined to instantiate
+ * memcpy_variant with other threshold sizes, so the exported functions are
+ * only defined here.
+ */
+#ifndef HOST_TUNE_GRID
+
+/* Plain C word copy, the baseline for the "original" kernel functions. */
+
+static void *memcpy_portable(void *dest, const void *src, size_t n) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+    if (n >= 8 && (((uintptr_t)d ^ (uintptr_t)s) & 3) == 0) {
+        while ((uintptr_t)d & 3) {
+            *d++ = *s++;
+            n--;
+        }
+        for (; n >= 4; n -= 4, d += 4, s += 4)
+            *(uint32_t *)d = *(const uint32_t *)s;
+    }
+    copy_bytes(d, s, n);
+    return dest;
+}
+
+static void *memset_portable(void *dest, int c, size_t n) {
+    uint8_t *d = dest;
+    uint32_t w = 0x01010101U * (uint8_t)c;
+    while (n > 0 && ((uintptr_t)d & 3)) {
+        *d++ = c;
+        n--;
+    }
+    for (; n >= 4; n -= 4, d += 4)
+        *(uint32_t *)d = w;
+    for (; n > 0; n--)
+        *d++ = c;
+    return dest;
+}
+
+void *kernel_memcpy_orig(void *dest, const void *src, size_t size) {
+    return memcpy_portable(dest, src, size);
+}
+
+void *kernel_memcpy_armv6v7(void *dest, const void *src, size_t size) {
+    return memcpy_variant(dest, src, size, L1_CACHE_BYTES, PREFETCH_DISTANCE,
+        WRITE_ALIGN_BYTES, 0);
+}
+
+/*
+ * On ARM the user copy functions differ from memcpy in their load/store
+ * sequences and fault handling. On the host they share the memcpy code
+ * without write alignment, which the ARM versions don't use either.
+ */
+
+void *kernel_copy_from_user_armv6v7(void *dest, const void *src, size_t size) {
+    return memcpy_variant(dest, src, size, L1_CACHE_BYTES, PREFETCH_DISTANCE,
+        0, 0);
+}
+
+void *kernel_copy_to_user_armv6v7(void *dest, const void *src, size_t size) {
+    return memcpy_variant(dest, src, size, L1_CACHE_BYTES, PREFETCH_DISTANCE,
+        0, 0);
+}
+
+/*
+ * Copy (if copy is set) and return the 32-bit partial Internet checksum of
+ * n bytes added to sum. The sum of 32-bit words is accumulated in 64 bits
+ * and folded with end-around carry, which folds to the same 16-bit
+ * checksum as the adcs chain of csum_copy_template.S.
+ */
+static ALWAYS_INLINE uint32_t csum_copy(uint8_t *d, const uint8_t *s,
+size_t n, uint32_t sum, int copy) {
+    uint64_t total = sum;
+    for (; n >= 8; n -= 8) {
+        uint64_t w = load64(s);
+        if (copy) {
+            store64(d, w);
+            d += 8;
+        }
+        total += (w & 0xFFFFFFFF) + (w >> 32);
+        s += 8;
+    }
+    if (n >= 4) {
+        uint32_t w = load32(s);
+        if (copy) {
+            store32(d, w);
+            d += 4;
+        }
+        total += w;
+        s += 4;
+        n -= 4;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (copy)
+            d[i] = s[i];
+        total += (uint32_t)s[i] << ((i & 1) * 8);
+    }
+    total = (total & 0xFFFFFFFF) + (total >> 32);
+    total = (total & 0xFFFFFFFF) + (total >> 32);
+    return total;
+}
+
+uint32_t kernel_csum_partial_copy_armv6v7(void *dest, const void *src,
+size_t size, uint32_t sum) {
+    return csum_copy(dest, src, size, sum, 1);
+}
+
+uint32_t kernel_csum_partial_armv6v7(const void *buf, size_t size,
+uint32_t sum) {
+    return csum_copy(NULL, buf, size, sum, 0);
+}
+
+void kernel_copy_page_orig(void *to, const void *from) {
+    memcpy_portable(to, from, PAGE_SZ);
+}
+
+/*
+ * Copy a page with one prefetch per cache line, making sure no prefetching
+ * happens beyond the source page (see copy_page.S).
+ */
+void kernel_copy_page(void *to, const void *from) {
+    uint8_t *d = to;
+    const uint8_t *s = from;
+    int count = PAGE_SZ / L1_CACHE_BYTES;
+    for (int i = 0; i < PREFETCH_DISTANCE; i++)
+        __builtin_prefetch(s + i * L1_CACHE_BYTES);
+    for (; count > PREFETCH_DISTANCE; count--) {
+        __builtin_prefetch(s + PREFETCH_DISTANCE * L1_CACHE_BYTES);
+        copy_line(d, s, L1_CACHE_BYTES);
+        d += L1_CACHE_BYTES;
+        s += L1_CACHE_BYTES;
+    }
+    for (; count > 0; count--) {
+        copy_line(d, s, L1_CACHE_BYTES);
+        d += L1_CACHE_BYTES;
+        s += L1_CACHE_BYTES;
+    }
+}
+
+void *kernel_memset_orig(void *dest, int c, size_t size) {
+    return memset_portable(dest, c, size);
+}
+
+void *kernel_memset(void *dest, int c, size_t size) {
+    return memset_variant(dest, c, size, MEMSET_WRITE_ALIGN_BYTES);
+}
+
+void *__kernel_memzero_orig(void *dest, size_t size) {
+    return memset_portable(dest, 0, size);
+}
+
+void *__kernel_memzero(void *dest, size_t size) {
+    return memset_variant(dest, 0, size, MEMSET_WRITE_ALIGN_BYTES);
+}
+
+/* The instantiations of new_arm.S. */
+
+void *memcpy_new_line_size_64_preload_192(void *dest, const void *src,
+size_t n) {
+    return memcpy_variant(dest, src, n, 64, 3, 0, 0);
+}
+
+void *memcpy_new_line_size_64_preload_192_align_32(void *dest, const void *src,
+size_t n) {
+    return memcpy_variant(dest, src, n, 64, 3, 32, 0);
+}
+
+void *memcpy_new_line_size_64_preload_192_aligned_access(void *dest,
+const void *src, size_t n) {
+    return memcpy_variant(dest, src, n, 64, 3, 0, 1);
+}
+
+void *memcpy_new_line_size_32_preload_192(void *dest, const void *src,
+size_t n) {
+    return memcpy_variant(dest, src, n, 32, 6, 0, 0);
+}
+
+void *memcpy_new_line_size_32_preload_192_align_32(void *dest, const void *src,
+size_t n) {
+    return memcpy_variant(dest, src, n, 32, 6, 32, 0);
+}
+
+void *memcpy_new_line_size_32_preload_96(void *dest, const void *src,
+size_t n) {
+    return memcpy_variant(dest, src, n, 32, 3, 8, 0);
+}
+
+void *memcpy_new_line_size_32_preload_96_aligned_access(void *dest,
+const void *src, size_t n) {
+    return memcpy_variant(dest, src, n, 32, 3, 8, 1);
+}
+
+/*
+ * The C equivalent of memcpy_size_class_variant in new_arm.S. Sizes up to 64
+ * bytes are dispatched through a switch (compiled to a jump table) to a
+ * constant size copy; the aligned and unaligned classes of the ARM version
+ * collapse into one here because unaligned accesses are cheap on the host.
+ */
+#define SIZE_CLASS_CASE(size) \
+    case size: __builtin_memcpy(dest, src, size); return dest;
+
+#define SIZE_CLASS_CASES_8(base) \
+    SIZE_CLASS_CASE(base) SIZE_CLASS_CASE(base + 1) \
+    SIZE_CLASS_CASE(base + 2) SIZE_CLASS_CASE(base + 3) \
+    SIZE_CLASS_CASE(base + 4) SIZE_CLASS_CASE(base + 5) \
+    SIZE_CLASS_CASE(base + 6) SIZE_CLASS_CASE(base + 7)
+
+static ALWAYS_INLINE void *memcpy_size_class_variant(void *dest,
+const void *src, size_t n, int line_size, int prefetch_distance,
+int write_align) {
+    switch (n) {
+    SIZE_CLASS_CASES_8(0)
+    SIZE_CLASS_CASES_8(8)
+    SIZE_CLASS_CASES_8(16)
+    SIZE_CLASS_CASES_8(24)
+    SIZE_CLASS_CASES_8(32)
+    SIZE_CLASS_CASES_8(40)
+    SIZE_CLASS_CASES_8(48)
+    SIZE_CLASS_CASES_8(56)
+    SIZE_CLASS_CASE(64)
+    default:
+        return memcpy_variant(dest, src, n, line_size, prefetch_distance,
+            write_align, 0);
+    }
+}
+
+void *memcpy_new_size_class_line_size_64_preload_192(void *dest,
+const void *src, size_t n) {
+    return memcpy_size_class_variant(dest, src, n, 64, 3, 0);
+}
+
+void *memcpy_new_size_class_line_size_32_preload_96(void *dest,
+const void *src, size_t n) {
+    return memcpy_size_class_variant(dest, src, n, 32, 3, 8);
+}
+
+/*
+ * The vector code of memcpy_variant and memset_variant is already the host
+ * equivalent of the NEON variants of new_arm.S.
+ */
+
+void *memcpy_new_neon_line_size_64_preload_192(void *dest, const void *src,
+size_t n) {
+    return memcpy_variant(dest, src, n, 64, 3, 0, 0);
+}
+
+void *memcpy_new_neon_line_size_64_preload_192_align_32(void *dest,
+const void *src, size_t n) {
+    return memcpy_variant(dest, src, n, 64, 3, 32, 0);
+}
+
+void *memcpy_new_neon_line_size_32_preload_192_align_32(void *dest,
+const void *src, size_t n) {
+    return memcpy_variant(dest, src, n, 32, 6, 32, 0);
+}
+
+void *memset_new_neon_align_0(void *dest, int c, size_t size) {
+    return memset_variant(dest, c, size, 0);
+}
+
+void *memset_new_neon_align_32(void *dest, int c, size_t size) {
+    return memset_variant(dest, c, size, 32);
+}
+
+void *memcpy_new_large_line_size_64_preload_192(void *dest, const void *src,
+size_t n) {
+    return memcpy_large_variant(dest, src, n, 64, 3, 0, 8);
+}
+
+void *memcpy_new_large_line_size_32_preload_96(void *dest, const void *src,
+size_t n) {
+    return memcpy_large_variant(dest, src, n, 32, 3, 8, 8);
+}
+
+void *memmove_new_line_size_64_preload_192(void *dest, const void *src,
+size_t n) {
+    return memmove_variant(dest, src, n, 64, 3, 0);
+}
+
+void *memmove_new_line_size_32_preload_96(void *dest, const void *src,
+size_t n) {
+    return memmove_variant(dest, src, n, 32, 3, 8);
+}
+
+void *memset_new_align_0(void *dest, int c, size_t size) {
+    return memset_variant(dest, c, size, 0);
+}
+
+void *memset_new_align_8(void *dest, int c, size_t size) {
+    return memset_variant(dest, c, size, 8);
+}
+
+void *memset_new_align_32(void *dest, int c, size_t size) {
+    return memset_variant(dest, c, size, 32);
+}
+
+/*
+ * The C equivalent of memcpy_crc32c_variant in new_arm.S. The "crc32"
+ * variants use the SSE4.2 crc32 instruction when it is available (it
+ * computes the same CRC32C), and the slice-by-8 tables otherwise. Table k
+ * holds the CRC of a byte followed by k zero bytes.
+ */
+static uint32_t crc32c_table[8][256];
+
+static void __attribute__((constructor)) crc32c_init_table(void) {
+    for (int i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ (0x82F63B78 & - (crc & 1));
+        crc32c_table[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++)
+        for (int i = 0; i < 256; i++)
+            crc32c_table[k][i] = (crc32c_table[k - 1][i] >> 8) ^
+                crc32c_table[0][crc32c_table[k - 1][i] & 0xFF];
+}
+
+static ALWAYS_INLINE uint32_t crc32c_8_bytes(uint32_t crc, uint64_t w,
+int crc_insn) {
+#if !defined(HOST_NO_SIMD) && defined(__SSE4_2__)
+    if (crc_insn)
+        return _mm_crc32_u64(crc, w);
+#endif
+    uint32_t lo = (uint32_t)w ^ crc;
+    uint32_t hi = w >> 32;
+    return crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+        crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+        crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+        crc32c_table[1][(hi >> 16) & 0xFF] ^ crc32c_table[0][hi >> 24];
+}
+
+static ALWAYS_INLINE uint32_t crc32c_byte(uint32_t crc, uint8_t b,
+int crc_insn) {
+#if !defined(HOST_NO_SIMD) && defined(__SSE4_2__)
+    if (crc_insn)
+        return _mm_crc32_u8(crc, b);
+#endif
+    return crc32c_table[0][(crc ^ b) & 0xFF] ^ (crc >> 8);
+}
+
+static ALWAYS_INLINE uint32_t memcpy_crc32c_variant(uint8_t *d,
+const uint8_t *s, size_t n, uint32_t crc, int crc_insn, int copy) {
+    for (; n >= 8; n -= 8) {
+        uint64_t w = load64(s);
+        if (copy) {
+            store64(d, w);
+            d += 8;
+        }
+        crc = crc32c_8_bytes(crc, w, crc_insn);
+        s += 8;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (copy)
+            d[i] = s[i];
+        crc = crc32c_byte(crc, s[i], crc_insn);
+    }
+    return crc;
+}
+
+uint32_t memcpy_crc32c_new_line_size_64_preload_192(void *dest,
+const void *src, size_t n, uint32_t crc) {
+    return memcpy_crc32c_variant(dest, src, n, crc, 0, 1);
+}
+
+uint32_t memcpy_crc32c_new_crc32_line_size_64_preload_192(void *dest,
+const void *src, size_t n, uint32_t crc) {
+    return memcpy_crc32c_variant(dest, src, n, crc, 1, 1);
+}
+
+uint32_t crc32c_new_line_size_64_preload_192(const void *src, size_t n,
+uint32_t crc) {
+    return memcpy_crc32c_variant(NULL, src, n, crc, 0, 0);
+}
+
+uint32_t crc32c_new_crc32_line_size_64_preload_192(const void *src, size_t n,
+uint32_t crc) {
+    return memcpy_crc32c_variant(NULL, src, n, crc, 1, 0);
+}
+
+/*
+ * The C equivalent of memcpy_vec_variant in new_arm.S. The source of the
+ * next descriptor is prefetched before the current one is copied.
+ */
+
+static ALWAYS_INLINE void memcpy_vec_variant(const struct copy_desc *descs,
+size_t n, int line_size, int prefetch_distance, int write_align) {
+    for (size_t i = 0; i < n; i++) {
+        if (i + 1 < n)
+            __builtin_prefetch(descs[i + 1].src);
+        memcpy_variant(descs[i].dest, descs[i].src, descs[i].n, line_size,
+            prefetch_distance, write_align, 0);
+    }
+}
+
+void memcpy_vec_new_line_size_64_preload_192(const struct copy_desc *descs,
+size_t n) {
+    memcpy_vec_variant(descs, n, 64, 3, 0);
+}
+
+void memcpy_vec_new_line_size_32_preload_96(const struct copy_desc *descs,
+size_t n) {
+    memcpy_vec_variant(descs, n, 32, 3, 8);
+}
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * Cache and alignment parameters for the host (non-ARM) backend in host.c.
+ * These play the role of kernel_defines.h for the assembler sources. The
+ * values match common x86-64 processors (64-byte cache lines).
+ */
+
+#define L1_CACHE_BYTES 64
+#define PREFETCH_DISTANCE 3
+#define PAGE_SZ 4096
+
+/* Write alignment used by the optimized kernel memcpy and memset. */
+#define WRITE_ALIGN_BYTES 32
+#define MEMSET_WRITE_ALIGN_BYTES 32
+
+/*
+ * The threshold sizes of the memcpy_variant implementation, equivalent to
+ * the constants of the same name in new_arm.S. They are overridden for the
+ * parameter grid in host_tune.c.
+ */
+#ifndef FAST_PATH_THRESHOLD
+#define FAST_PATH_THRESHOLD 256
+#endif
+#ifndef SMALL_SIZE_THRESHOLD
+#define SMALL_SIZE_THRESHOLD 15
+#endif
+/*
+ * The threshold size for the large copy mode of memcpy_large_variant, about
+ * the size of the L2 cache.
+ */
+#ifndef LARGE_COPY_THRESHOLD
+#define LARGE_COPY_THRESHOLD (1024 * 1024)
+#endif
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2013 Harm Hanemaaijer <fgenfb@yahoo.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * The parameter grid for "benchmark --tune" on the host backend, the
+ * equivalent of new_arm_tune.S. This file is compiled once for every
+ * threshold set, with TUNE_SET_INDEX defined (see new_arm_tune.h).
+ */
+
+#include "new_arm_tune.h"
+
+#define HOST_TUNE_GRID
+#include "host.c"
+
+#define TUNE_FUNCTION(set, ls, pd, wa, aa) \
+void *TUNE_FUNCTION_NAME(set, ls, pd, wa, aa)(void *dest, const void *src, \
+size_t n) { \
+    return memcpy_variant(dest, src, n, ls, pd, wa, aa); \
+}
+
+TUNE_GRID(TUNE_FUNCTION, TUNE_SET)
@@ -56,6 +56,9 @@
 #define THUMB(instr...)
 #endif
 
+/* The rest of this file is only used by the assembler sources. */
+#ifdef __ASSEMBLER__
+
 .macro asm_function function_name
     .global \function_name
 .func \function_name
@@ -63,6 +66,28 @@
 \function_name:
 .endm
 
+/*
+ * Emit a user access instruction and record it in the exception table (the
+ * __ex_table section) together with the address of the fixup code to
+ * continue at when it faults, like the kernel's USER() macro. The entries
+ * hold offsets relative to themselves so that they need no dynamic
+ * relocations. In Thumb-2 mode a conditional access gets its own IT block,
+ * so that the recorded address is the one of the access itself. The fault
+ * handler is uaccess_fault_handler() in benchmark.c.
+ */
+.macro user_access cond, abort, instr:vararg
+.ifnc \cond, al
+THUMB(	it	\cond	)
+.endif
+9999:	\instr
+	.pushsection __ex_table, "a"
+	.align	2
+	.long	9999b - ., \abort - .
+	.popsection
+.endm
+
 #ifdef CONFIG_THUMB2_KERNEL
 .syntax unified
 #endif
+
+#endif
@@ -20,8 +20,64 @@ extern void *memcpy_new_line_size_32_preload_96(void *dest,
 extern void *memcpy_new_line_size_32_preload_96_aligned_access(void *dest,
     const void *src, size_t n);
 
+extern void *memcpy_new_size_class_line_size_64_preload_192(void *dest,
+    const void *src, size_t n);
+
+extern void *memcpy_new_size_class_line_size_32_preload_96(void *dest,
+    const void *src, size_t n);
+
+extern void *memcpy_new_large_line_size_64_preload_192(void *dest,
+    const void *src, size_t n);
+
+extern void *memcpy_new_large_line_size_32_preload_96(void *dest,
+    const void *src, size_t n);
+
+extern void *memmove_new_line_size_64_preload_192(void *dest,
+    const void *src, size_t n);
+
+extern void *memmove_new_line_size_32_preload_96(void *dest,
+    const void *src, size_t n);
+
 extern void *memset_new_align_0(void *dest, int c, size_t size);
 
 extern void *memset_new_align_8(void *dest, int c, size_t size);
 
 extern void *memset_new_align_32(void *dest, int c, size_t size);
+
+extern void *memcpy_new_neon_line_size_64_preload_192(void *dest,
+    const void *src, size_t n);
+
+extern void *memcpy_new_neon_line_size_64_preload_192_align_32(void *dest,
+    const void *src, size_t n);
+
+extern void *memcpy_new_neon_line_size_32_preload_192_align_32(void *dest,
+    const void *src, size_t n);
+
+extern void *memset_new_neon_align_0(void *dest, int c, size_t size);
+
+extern void *memset_new_neon_align_32(void *dest, int c, size_t size);
+
+extern uint32_t memcpy_crc32c_new_line_size_64_preload_192(void *dest,
+    const void *src, size_t n, uint32_t crc);
+
+extern uint32_t memcpy_crc32c_new_crc32_line_size_64_preload_192(void *dest,
+    const void *src, size_t n, uint32_t crc);
+
+extern uint32_t crc32c_new_line_size_64_preload_192(const void *src, size_t n,
+    uint32_t crc);
+
+extern uint32_t crc32c_new_crc32_line_size_64_preload_192(const void *src,
+    size_t n, uint32_t crc);
+
+/* One copy in a batch passed to memcpy_vec. */
+struct copy_desc {
+    void *dest;
+    const void *src;
+    size_t n;
+};
+
+extern void memcpy_vec_new_line_size_64_preload_192(
+    const struct copy_desc *descs, size_t n);
+
+extern void memcpy_vec_new_line_size_32_preload_96(
+    const struct copy_desc *descs, size_t n);
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2013 Harm Hanemaaijer <fgenfb@yahoo.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * The parameter grid of memcpy_variant instantiations used by
+ * "benchmark --tune". new_arm_tune.S (host_tune.c for the host backend) is
+ * assembled once for every threshold set, with TUNE_SET_INDEX selecting the
+ * set, and instantiates memcpy_variant for every combination of line size,
+ * prefetch distance, write alignment and aligned access. The functions are
+ * named memcpy_tune_<set>_<line size>_<prefetch distance>_<write align>_
+ * <aligned access>.
+ */
+
+/*
+ * The threshold sets: name, FAST_PATH_THRESHOLD, SMALL_SIZE_THRESHOLD,
+ * UNALIGNED_SMALL_SIZE_THRESHOLD and BOTH_UNALIGNED_SMALL_SIZE_THRESHOLD.
+ * The last set is the code-reduced configuration without fast path.
+ */
+#define TUNE_THRESHOLD_SETS(Y) \
+    Y(t256_15, 256, 15, 64, 32) \
+    Y(t128_15, 128, 15, 64, 32) \
+    Y(t256_31, 256, 31, 64, 32) \
+    Y(t0, 0, 0, 0, 0)
+
+#define NU_TUNE_THRESHOLD_SETS 4
+
+/* Must match TUNE_THRESHOLD_SETS. */
+#ifdef TUNE_SET_INDEX
+#if TUNE_SET_INDEX == 0
+#define TUNE_SET t256_15
+#define FAST_PATH_THRESHOLD 256
+#define SMALL_SIZE_THRESHOLD 15
+#define UNALIGNED_SMALL_SIZE_THRESHOLD 64
+#define BOTH_UNALIGNED_SMALL_SIZE_THRESHOLD 32
+#elif TUNE_SET_INDEX == 1
+#define TUNE_SET t128_15
+#define FAST_PATH_THRESHOLD 128
+#define SMALL_SIZE_THRESHOLD 15
+#define UNALIGNED_SMALL_SIZE_THRESHOLD 64
+#define BOTH_UNALIGNED_SMALL_SIZE_THRESHOLD 32
+#elif TUNE_SET_INDEX == 2
+#define TUNE_SET t256_31
+#define FAST_PATH_THRESHOLD 256
+#define SMALL_SIZE_THRESHOLD 31
+#define UNALIGNED_SMALL_SIZE_THRESHOLD 64
+#define BOTH_UNALIGNED_SMALL_SIZE_THRESHOLD 32
+#else
+#define TUNE_SET t0
+#define FAST_PATH_THRESHOLD 0
+#define SMALL_SIZE_THRESHOLD 0
+#define UNALIGNED_SMALL_SIZE_THRESHOLD 0
+#define BOTH_UNALIGNED_SMALL_SIZE_THRESHOLD 0
+#endif
+#endif
+
+#ifndef __ASSEMBLER__
+
+/*
+ * Expand X(set, line_size, prefetch_distance, write_align, aligned_access)
+ * for every grid point of a threshold set. The same grid is generated with
+ * .irp loops in new_arm_tune.S.
+ */
+#define TUNE_GRID_ALIGNED_ACCESS(X, set, ls, pd, wa) \
+    X(set, ls, pd, wa, 0) X(set, ls, pd, wa, 1)
+#define TUNE_GRID_WRITE_ALIGN(X, set, ls, pd) \
+    TUNE_GRID_ALIGNED_ACCESS(X, set, ls, pd, 0) \
+    TUNE_GRID_ALIGNED_ACCESS(X, set, ls, pd, 8) \
+    TUNE_GRID_ALIGNED_ACCESS(X, set, ls, pd, 16) \
+    TUNE_GRID_ALIGNED_ACCESS(X, set, ls, pd, 32) \
+    TUNE_GRID_ALIGNED_ACCESS(X, set, ls, pd, 64)
+#define TUNE_GRID_PREFETCH_DISTANCE(X, set, ls) \
+    TUNE_GRID_WRITE_ALIGN(X, set, ls, 2) \
+    TUNE_GRID_WRITE_ALIGN(X, set, ls, 3) \
+    TUNE_GRID_WRITE_ALIGN(X, set, ls, 4) \
+    TUNE_GRID_WRITE_ALIGN(X, set, ls, 5) \
+    TUNE_GRID_WRITE_ALIGN(X, set, ls, 6) \
+    TUNE_GRID_WRITE_ALIGN(X, set, ls, 7) \
+    TUNE_GRID_WRITE_ALIGN(X, set, ls, 8)
+#define TUNE_GRID(X, set) \
+    TUNE_GRID_PREFETCH_DISTANCE(X, set, 32) \
+    TUNE_GRID_PREFETCH_DISTANCE(X, set, 64)
+
+#define TUNE_FUNCTION_NAME(set, ls, pd, wa, aa) \
+    memcpy_tune_##set##_##ls##_##pd##_##wa##_##aa
+
+#endif
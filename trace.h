@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2013 Harm Hanemaaijer <fgenfb@yahoo.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * Binary format of the memcpy/memset traces written by trace_shim.so and
+ * replayed by "benchmark --trace <file>".
+ *
+ * A trace consists of a trace_header_t followed by trace_record_t records
+ * in native byte order. Addresses are stored modulo TRACE_WINDOW, which
+ * preserves their alignment and relative placement within the window, and
+ * sizes are clamped to TRACE_WINDOW, so that the replay can map every
+ * record into the benchmark buffer.
+ */
+
+#include <stdint.h>
+
+#define TRACE_MAGIC 0x4352544D /* "MTRC" */
+#define TRACE_VERSION 1
+
+#define TRACE_WINDOW (8 * 1024 * 1024)
+
+/* Set in the size field of memset records. */
+#define TRACE_MEMSET 0x80000000U
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+} trace_header_t;
+
+typedef struct {
+    uint32_t dst_offset;
+    /* The fill value for memset records. */
+    uint32_t src_offset;
+    uint32_t size;
+} trace_record_t;
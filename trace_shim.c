@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2013 Harm Hanemaaijer <fgenfb@yahoo.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * LD_PRELOAD shim that records the memcpy and memset calls of a program in
+ * the trace format defined in trace.h, for replay with
+ * "benchmark --trace <file>". Build it with "make trace_shim.so" and run
+ *
+ *     MEMCPY_TRACE_FILE=service.%p.trace LD_PRELOAD=./trace_shim.so <program>
+ *
+ * A "%p" in the file name is replaced by the process ID (the default is
+ * "memcpy.%p.trace"). Records are buffered per thread and written when the
+ * buffer is full, when the thread exits and when the process exits; records
+ * of threads still running at exit are lost. Children created with fork()
+ * are not traced. Calls that the compiler inlines or that libc makes
+ * internally are not seen by the shim.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "trace.h"
+
+#define TRACE_BUFFER_RECORDS 4096
+
+/* Avoid calls to __tls_get_addr, which may end up in memcpy or memset. */
+#define THREAD_LOCAL __thread __attribute__((tls_model("initial-exec")))
+
+typedef void *(*memcpy_func_type)(void *dest, const void *src, size_t n);
+typedef void *(*memset_func_type)(void *dest, int c, size_t n);
+
+static memcpy_func_type real_memcpy;
+static memset_func_type real_memset;
+static int trace_fd = - 1;
+static pthread_key_t trace_key;
+
+static THREAD_LOCAL trace_record_t *buffer;
+static THREAD_LOCAL int nu_buffered;
+/* Set while inside the shim, so that nested calls are not recorded. */
+static THREAD_LOCAL int busy;
+
+static void flush_buffer() {
+    if (nu_buffered > 0 && trace_fd >= 0)
+        if (write(trace_fd, buffer, nu_buffered * sizeof(trace_record_t)) < 0)
+            trace_fd = - 1;
+    nu_buffered = 0;
+}
+
+static void thread_exit(void *arg) {
+    busy = 1;
+    flush_buffer();
+}
+
+static void fork_child() {
+    nu_buffered = 0;
+    trace_fd = - 1;
+}
+
+static void record(void *dest, uint32_t src_offset, size_t n, uint32_t flags) {
+    if (trace_fd < 0 || busy)
+        return;
+    busy = 1;
+    if (buffer == NULL) {
+        void *p = mmap(NULL, TRACE_BUFFER_RECORDS * sizeof(trace_record_t),
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, - 1, 0);
+        if (p == MAP_FAILED) {
+            busy = 0;
+            return;
+        }
+        buffer = p;
+        /* The key's destructor flushes the buffer when the thread exits. */
+        pthread_setspecific(trace_key, buffer);
+    }
+    trace_record_t *r = &buffer[nu_buffered++];
+    r->dst_offset = (uintptr_t)dest & (TRACE_WINDOW - 1);
+    r->src_offset = src_offset;
+    r->size = (n > TRACE_WINDOW ? TRACE_WINDOW : n) | flags;
+    if (nu_buffered == TRACE_BUFFER_RECORDS)
+        flush_buffer();
+    busy = 0;
+}
+
+void *memcpy(void *dest, const void *src, size_t n) {
+    record(dest, (uintptr_t)src & (TRACE_WINDOW - 1), n, 0);
+    if (real_memcpy == NULL) {
+        /* Called before the shim is initialized (for example by dlsym). */
+        for (size_t i = 0; i < n; i++)
+            ((uint8_t *)dest)[i] = ((const uint8_t *)src)[i];
+        return dest;
+    }
+    return real_memcpy(dest, src, n);
+}
+
+void *memset(void *dest, int c, size_t n) {
+    record(dest, c & 0xFF, n, TRACE_MEMSET);
+    if (real_memset == NULL) {
+        for (size_t i = 0; i < n; i++)
+            ((uint8_t *)dest)[i] = c;
+        return dest;
+    }
+    return real_memset(dest, c, n);
+}
+
+/* Entry points of fortified (_FORTIFY_SOURCE) builds. */
+
+void *__memcpy_chk(void *dest, const void *src, size_t n, size_t dest_len) {
+    if (n > dest_len)
+        abort();
+    return memcpy(dest, src, n);
+}
+
+void *__memset_chk(void *dest, int c, size_t n, size_t dest_len) {
+    if (n > dest_len)
+        abort();
+    return memset(dest, c, n);
+}
+
+/* Expand "%p" in the trace file name to the process ID. */
+static void get_trace_file_name(char *name, int size) {
+    const char *pattern = getenv("MEMCPY_TRACE_FILE");
+    if (pattern == NULL)
+        pattern = "memcpy.%p.trace";
+    const char *p = strstr(pattern, "%p");
+    if (p == NULL)
+        snprintf(name, size, "%s", pattern);
+    else
+        snprintf(name, size, "%.*s%d%s", (int)(p - pattern), pattern,
+            (int)getpid(), p + 2);
+}
+
+static void __attribute__((constructor)) trace_init() {
+    char name[4096];
+    trace_header_t header;
+    busy = 1;
+    real_memcpy = (memcpy_func_type)dlsym(RTLD_NEXT, "memcpy");
+    real_memset = (memset_func_type)dlsym(RTLD_NEXT, "memset");
+    get_trace_file_name(name, sizeof(name));
+    int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) {
+        busy = 0;
+        return;
+    }
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+        close(fd);
+        busy = 0;
+        return;
+    }
+    pthread_key_create(&trace_key, thread_exit);
+    pthread_atfork(NULL, NULL, fork_child);
+    trace_fd = fd;
+    busy = 0;
+}
+
+static void __attribute__((destructor)) trace_exit() {
+    busy = 1;
+    flush_buffer();
+}